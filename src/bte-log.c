@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2014 - 2020 <aiy@ferens.net> 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * decoder of libbte binary log: prints records of all threads in time order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "bte.h"
+#include "btelog.h"
+
+#define ULLOG_DEST (ULLOG_DEST_STDOUT)
+#define ULLOG_LEVEL ULLOG_NOTICE
+#include "ullog.h"
+
+#define BTELOG_TEXT(id, level, text) text,
+static const char *log_fmt_text[] = { BTELOG_FORMATS(BTELOG_TEXT) };
+#undef BTELOG_TEXT
+
+static int
+_rec_cmp(const void *a, const void *b)
+{
+    const btelog_rec_t *ra = a;
+    const btelog_rec_t *rb = b;
+
+    if (ra->ts != rb->ts) {
+        return ra->ts < rb->ts ? -1 : 1;
+    }
+    return (int) ra->thread - (int) rb->thread;
+}
+
+/**
+ * \brief   print record with its format, %d takes next arg as integer 
+ *  and %r as rc
+ */
+static void
+printRecord(const btelog_rec_t *rec, long long first)
+{
+    const char *fmt = NULL;
+    unsigned int arg = 0;
+    long long v = 0;
+
+    printf("%12.6f t%u ", (rec->ts - first) / 1e9, rec->thread);
+    if (rec->node == BTELOG_NO_NODE) {
+        printf("tree: ");
+    } else {
+        printf("node %u: ", rec->node);
+    }
+    if (rec->fmt >= LOG_FORMATS_N) {
+        // log of newer writer
+        printf("format %u %lld %lld %lld\n", rec->fmt, 
+                rec->args[0], rec->args[1], rec->args[2]);
+        return;
+    }
+    for (fmt = log_fmt_text[rec->fmt]; *fmt; ++fmt) {
+        if (fmt[0] != '%' || (fmt[1] != 'd' && fmt[1] != 'r')) {
+            putchar(*fmt);
+            continue;
+        }
+        v = arg < BTELOG_ARGS ? rec->args[arg++] : 0;
+        if (*++fmt == 'r') {
+            printf("%s", bte_rc_str((bte_rc_t) v));
+        } else {
+            printf("%lld", v);
+        }
+    }
+    putchar('\n');
+}
+
+/**
+ * \brief   read log file and print its records
+ * \return:
+ *  0 - success
+ *  1 - error
+ */
+static int
+decodeFile(const char *filename)
+{
+    ullog_debug("enter");
+
+    int task_rc = 1;
+    FILE *fp = NULL;
+    btelog_header_t hdr;
+    btelog_rec_t *recs = NULL;
+    unsigned long long i = 0;
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+        ullog_err("cannot open %s: %s", filename, strerror(errno));
+        goto bail;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || 
+            memcmp(hdr.magic, BTELOG_MAGIC, sizeof(hdr.magic)) || 
+            hdr.version != BTELOG_VERSION || 
+            hdr.rec_size != sizeof(btelog_rec_t)) {
+        ullog_err("%s is not bte log", filename);
+        goto bail;
+    }
+    if (hdr.recs_n && (recs = calloc(hdr.recs_n, sizeof(btelog_rec_t))) == NULL) {
+        ullog_err("cannot allocate %llu records", hdr.recs_n);
+        goto bail;
+    }
+    if (fread(recs, sizeof(btelog_rec_t), hdr.recs_n, fp) != hdr.recs_n) {
+        ullog_err("%s is truncated", filename);
+        goto bail;
+    }
+    // rings of threads are stored one after another
+    qsort(recs, hdr.recs_n, sizeof(btelog_rec_t), _rec_cmp);
+    for (i = 0; i < hdr.recs_n; ++i) {
+        printRecord(&recs[i], recs[0].ts);
+    }
+    task_rc = 0;
+
+    bail:
+    if (recs) free(recs);
+    if (fp) fclose(fp);
+
+    ullog_debug("exit");
+    return task_rc;
+}
+
+int 
+main(int argc, char *argv[])
+{
+    ullog_init("bte-log");
+
+    int task_rc = 1;
+
+    if (argc != 2) {
+        ullog_err("usage: %s log.btel", argv[0]);
+        goto bail;
+    }
+    task_rc = decodeFile(argv[1]);
+
+    bail:
+    ullog_deinit();
+    return task_rc;
+}
+
+// EOF
@@ -29,27 +29,24 @@
  */
 
 /*
-http://en.wikipedia.org/wiki/Behavior_Trees_(Artificial_Intelligence,_Robotics_and_Control)
-*/
+ * command line front end of libbte: runs tree file, serves trees on 
+ * unix socket or submits tree to server
+ */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h> // for isspace
-#include <unistd.h> // for dup
-#include <time.h>
+#include <unistd.h>
 #include <limits.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
-#include <libxml/xmlreader.h>
-#include <libxml/parser.h>
-#include <libxml/tree.h>
-#include <libxml/debugXML.h>
-
-#include <expect.h>
-
-#include "uthash.h"
+#include "bte.h"
 
 #define ULLOG_DEST (ULLOG_DEST_STDOUT)
 //#define ULLOG_DEST (ULLOG_DEST_STDOUT | ULLOG_DEST_STDERR)
@@ -58,1361 +55,752 @@ http://en.wikipedia.org/wiki/Behavior_Trees_(Artificial_Intelligence,_Robotics_a
 //#define ULLOG_LEVEL ULLOG_DEBUG
 #include "ullog.h"
 
-// VERSION 0.0.1
-static int g_debug = 0;
-static int g_expect_debug = 0;
-#define SELECT_SLEEP_USEC 100000
-
-enum {
-    ACTION,
-} node_type;
-
-enum os_type {
-    UNIX,
-};
-typedef enum os_type os_t;
-
-// return code 
-typedef enum {
-    RC_SUCCESS, // clean success
-    RC_FAILURE, // clean failure
-    RC_RUNNING, // running
-    RC_ERROR, // unexpected failure
-    RC_UNKNOWN, // unknown code
-} rc_t;
-
-typedef struct {
-    const int code;
-    const char *str;
-} rcs_t;
-
-const rcs_t rcs_str_mapping[] = {
-    {RC_SUCCESS, "success"},
-    {RC_FAILURE, "failure"},
-    {RC_RUNNING, "running"},
-    {RC_ERROR, "error"},
-    {RC_UNKNOWN, NULL},
-};
-
-struct action_node {
-    char *value;
-    int type;
-    int os;
-};
-
-#define STREAM_CHUNK_SIZE 512
-#define STREAM_BUF_SIZE 2048
-typedef struct {
-    const char * id; // node id
-    FILE * fp; 
-    int fd;
-    fd_set fds;
-    char read_buf[STREAM_BUF_SIZE];
-    size_t read_bytes;
-    char write_buf[STREAM_BUF_SIZE];
-    size_t written_bytes;
-    UT_hash_handle hh; /* makes this structure hashable */
-} fp_table_t;
-static fp_table_t * fp_table = NULL;
-
-static rc_t processFile(const char *filename);
-static rc_t processRootNode(xmlNodePtr node);
-static rc_t processNode(xmlNodePtr node);
-static rc_t processDecoratorNode(xmlNodePtr node);
-static rc_t processDecoratorSucceederNode(xmlNodePtr node);
-static rc_t processSequenceNode(xmlNodePtr node);
-static rc_t processSelectNode(xmlNodePtr node);
-static rc_t processActionLeaf(xmlNodePtr node);
-
-// system specific
-static rc_t processActionExec(xmlNodePtr node);
-static rc_t processActionOpen(xmlNodePtr node);
-static rc_t processActionClose(xmlNodePtr node);
-static rc_t processActionExpect(xmlNodePtr node);
-static rc_t processActionWrite(xmlNodePtr node);
-
+#define SERVE_TICK_BUDGET 16 // ticks of one tree per loop iteration
+#define SERVE_OUT_MAX (4 * 1024 * 1024) // queued output stopping tree of slow client
+
+static const char *g_state_file = NULL; // dump node states to file after run
+static int g_stats = 0; // print run statistics to stderr
+static const char *g_trace_file = NULL; // write trace events to file after run
+static const char *g_log_file = NULL; // write binary log to file at exit
+static bte_log_level_t g_log_level = BTE_LOG_INFO; // level of binary log
+static volatile sig_atomic_t g_dump = 0; // write trace events and log now
+static const char *g_ckpt_file = NULL; // append checkpoint of run to file
+static int g_resume = 0; // skip nodes succeeded in checkpoint
+static int g_threads = -1; // run files on pool of threads, 0 is one per cpu
+
+#define TRACE_EVENTS 65536 // events kept in trace ring
+
+// tree submitted to server
+typedef struct session {
+    int fd; // client socket
+    char *req; // request being read
+    size_t req_n;
+    size_t req_size;
+    bte_tree_t *tree;
+    char *out; // frames queued for client
+    size_t out_n;
+    size_t out_off; // bytes of out already sent
+    size_t out_size;
+    int running; // request is read and tree is running
+    int done; // tree is finished, rc line is queued
+    int broken; // client is gone, output is dropped
+    int ready; // client or tree fds are ready
+    unsigned int pfd; // first poll fd of session
+    unsigned int pfd_n;
+    struct session *next;
+} session_t;
 
+/**
+ * \brief   write whole buffer to fd, retrying short writes
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
 static int
-print_fp_table(fp_table_t * fp_table) 
-{ 
-    fp_table_t *fp_table_item, *fp_table_item_tmp = NULL;
-    if (!fp_table) {
-        ullog_debug("fp_table is empty");
-    } else {
-        ullog_debug("fp_table p %p", fp_table);
-        HASH_ITER(hh, fp_table, fp_table_item, fp_table_item_tmp) {
-        ullog_debug("id '%s' fp %p fd %d read %d '%s' written %d '%s'", 
-                    fp_table_item->id, fp_table_item->fp , fp_table_item->fd,
-                    (int) fp_table_item->read_bytes, fp_table_item->read_buf,
-                    (int) fp_table_item->written_bytes, fp_table_item->write_buf);
-        }
-    }
-    return 0;
-}
-
-static int 
-nodeSetState(xmlNodePtr node, rc_t state_rc) 
+_write_all(int fd, const char *buf, size_t len)
 {
-    if(!xmlSetProp(node, (const xmlChar *) "_state_", 
-        (const xmlChar *) rcs_str_mapping[state_rc].str)) {
-        ullog_err("cannot write node state '%s' to tree", 
-                 rcs_str_mapping[state_rc].str);
-        return -1;
-    }
-    return 0;
-}
+    ssize_t n = 0;
 
-static const char * 
-rc2rstr(const int rc) {
-    int i = 0;
-    for (; rcs_str_mapping[i].code != RC_UNKNOWN; ++i) {
-        if(rcs_str_mapping[i].code == rc) {
-            return(rcs_str_mapping[i].str);
+    while (len) {
+        n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
         }
+        buf += n;
+        len -= n;
     }
-    return NULL;
+    return 0;
 }
 
-static int rand_init = 0;
-static char * 
-_gen_node_id(void)
+/**
+ * \brief   make sure buffer holds at least need items
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_grow(void **buf, size_t *size, size_t need, size_t item_size)
 {
-    char *id_str = NULL; 
-    if((id_str = malloc(255)) == NULL) { 
-        return NULL; 
+    size_t new_size = *size ? *size : 16;
+    void *p = NULL;
+
+    if (need <= *size) {
+        return 0;
     }
-    if(!rand_init) {
-        rand_init = 1;
-        srand(time(NULL));
+    while (new_size < need) {
+        new_size *= 2;
     }
-    if (sprintf(id_str, "%d", rand()) == -1) {
-        return NULL;
+    if ((p = realloc(*buf, new_size * item_size)) == NULL) {
+        return -1;
     }
-    return id_str;
+    *buf = p;
+    *size = new_size;
+    return 0;
 }
 
-static void 
-_xmlDump(xmlNode *node, int recursive) 
+static int
+_set_nonblock(int fd)
 {
-  if (node) {
-      printf("source line: %d\n", node->line);
-    if(recursive) {
-      xmlDebugDumpNode(stdout, node, -1);
-    } else {
-      xmlDebugDumpOneNode(stdout, node, -1);
-    }
-  }
+    int flags = fcntl(fd, F_GETFL);
 
-  if (g_debug) {
-    ullog_debug("enter");
-    /*
-    xmlChar *name, *value;
-
-    name = xmlTextReaderName(reader);
-    if (name == NULL)
-      name = xmlStrdup(BAD_CAST "--");
-    value = xmlTextReaderValue(reader);
-
-    log_debug("%s: element address %p depth %d type %d name %s empty %d",
-        __FUNCTION__, xmlTextReaderCurrentNode(reader),
-        xmlTextReaderDepth(reader), xmlTextReaderNodeType(reader), name,
-        xmlTextReaderIsEmptyElement(reader));
-    if (value) {
-      if (strlen((const char *) value) > 0) {
-        log_debug(" value '%s'", value);
-      }
-    }
-    log_debug("\n");
-    */
-
-    /*
-    if (name)
-      xmlFree(name);
-    if (value)
-      xmlFree(value);
-      */
-    ullog_debug("exit");
-  }
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
-/**
- * \brief   write asynchronously chunk of data   
- * \return:
- *  N - number of bytes written
- *  -1 - error, error number is in errno 
- *  -2 - receiver is nor ready, write again
- */
-int
-async_write_chunk(int fd, char * buf, size_t len)
+static void
+_dump_signal(int sig)
 {
-    int n = 0;
-    int tn = 0;
-    int i = 0;
-    int esc = 0;
-    char ch[STREAM_CHUNK_SIZE] = "";
-    char esc_ch[1] = "";
-
-    ullog_debug("async_write_chunk: buf '%s' len %zu", buf, len);
-    strcpy(ch, buf);
-    errno = 0;
-    while(ch[i]) {
-        ullog_debug("async_write_chunk: esc %d i %d ch %c", esc, i, ch[i]);
-        if(ch[i] == '\\') {
-            esc = 1; ++i; ++tn; continue; 
-        }
-        if(esc) {
-            esc = 0;
-            if(ch[i] == 'n') {
-                esc_ch[0] = '\n';
-                n = write(fd, &esc_ch, 1);
-            } else if(ch[i] == 'r') {
-                esc_ch[0] = '\r';
-                n = write(fd, &esc_ch, 1);
-            } 
-        } else {
-            n = write(fd, &ch[i], 1);
-        }
-        ullog_debug("async_write_chunk: n %d buf '%s' errno %d err '%s'",
-            n, &ch[i], errno, strerror(errno));
-        ++i;
-        if(n == -1 && errno == EAGAIN) {
-            ullog_debug("async_write_chunk: repeat write");
-            return -2;
-        }
-        tn += n;
-    }
-    ullog_debug("async_write_chunk: finish n %d buf '%s' errno %d err '%s'",
-            tn, &ch[i], errno, strerror(errno));
-    return tn;
+    g_dump = 1;
 }
 
-static rc_t 
-processActionExec(xmlNodePtr node) 
+static bte_rc_t
+processFile(const char *filename) 
 {
     ullog_debug("enter");
 
-    rc_t task_rc = RC_FAILURE;
-    xmlChar *node_id = NULL;
-    xmlChar *action_value = NULL;
-    char exec_path[PATH_MAX] = "";
-    xmlChar *action_state = NULL;
-    char exec_out_buff[255] = "";
-    fp_table_t *fp_table_item = NULL;
-    int c = 0;
-
-    node_id = xmlGetProp(node, (const xmlChar *) "id");
-    if (node_id && (strlen((const char *) node_id) > 0)) {
-        ullog_debug("node id '%s'", node_id);
-    } else {
-        ullog_debug("generating node id");
-        node_id = (xmlChar *) _gen_node_id();
-        if(!node_id) {
-            ullog_err("cannot generate node id");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        if(!xmlNewProp(node,  (const xmlChar *) "id", node_id)) {
-            ullog_err("cannot write node id to tree");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        ullog_debug("new generated node id '%s'", node_id);
-    }
-    print_fp_table(fp_table);
-
-    action_state = xmlGetProp(node,  (const xmlChar *) "_state_");
-    ullog_debug("action state '%s'", action_state);
-    if (action_state && 
-        (strncmp((const char *) action_state, "running", strlen("running")) == 0)) {
-        ullog_debug("action is running");
-    } else if (action_state && 
-        (strncmp((const char *) action_state, "success", strlen("success")) == 0)) {
-        ullog_debug("action is success");
-        task_rc = RC_SUCCESS;
-        goto bail;
-    } else {
-        ullog_debug("action is not set");
-        action_value = xmlNodeGetContent(node);
-        if (action_value) {
-            if (strlen((const char *) action_value) == 0) {
-                ullog_err("cannot read command value or it is empty");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
+    bte_tree_t *tree = NULL;
+    bte_rc_t task_rc = BTE_FAILURE;
+    long long start_ns = bte_now_ns();
 
-            ullog_debug("create store fp item");
-            fp_table_item = (fp_table_t*)malloc(sizeof(fp_table_t));
-            if(!fp_table_item) {
-                ullog_err("cannot create fp table item");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-            ullog_debug("action value '%s'", action_value);
-            strncat(exec_path, (const char *) action_value, PATH_MAX);
-            strncat(exec_path, " 2>&1", PATH_MAX);
-            ullog_debug("executing action '%s'", exec_path);
-            if(!(fp_table_item->fp = popen(exec_path, "r"))) {
-                ullog_err("cannot execute command '%s'", action_value);
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-            ullog_debug("start store fp in fp table");
-            fp_table_item->id = (const char *) node_id;
-            ullog_debug("id '%s'", fp_table_item->id);
-            ullog_debug("fp '%p'", fp_table_item->fp);
-            HASH_ADD_KEYPTR(hh, fp_table, 
-            fp_table_item->id, strlen(fp_table_item->id), fp_table_item);
-            ullog_debug("done store fp in fp table");
-
-        } else {
-            ullog_err("cannot read command value or it is empty");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
+    if ((tree = bte_load_file(filename)) == NULL) {
+        task_rc = BTE_ERROR;
+        goto bail;
     }
 
-    if(!fp_table_item) {
-        ullog_debug("search fp_table_item");
-        HASH_FIND_STR(fp_table, (const char *) node_id, fp_table_item);
+    if (g_ckpt_file && bte_set_checkpoint(tree, g_ckpt_file, g_resume)) {
+        task_rc = BTE_ERROR;
+        goto bail;
     }
-    ullog_debug("node_id '%p'", node_id);
-    ullog_debug("fp_table '%p'", fp_table);
-    ullog_debug("fp_table_item '%p'", fp_table_item);
-    if(!fp_table_item) {
-        ullog_err("cannot find open fp for node id '%s'", node_id);
-        task_rc = RC_ERROR;
+    if (g_trace_file && bte_set_trace(tree, TRACE_EVENTS)) {
+        task_rc = BTE_ERROR;
         goto bail;
     }
-
-    ullog_debug("start reading exec output");
-    if(fgets(exec_out_buff, 255, fp_table_item->fp) == NULL) {
-        if(!feof(fp_table_item->fp) || ferror(fp_table_item->fp)) {
-            ullog_err("cannot read output of command '%s'", action_value);
-            task_rc = RC_ERROR;
-            goto bail;
-        }
+    // SIGUSR1 writes trace of running tree
+    if (g_trace_file) {
+        signal(SIGUSR1, _dump_signal);
     }
-    ullog_debug("done reading exec output");
-
-    // check eof
-    c = getc(fp_table_item->fp); 
-    ungetc(c, fp_table_item->fp); 
-    if(feof(fp_table_item->fp)) {
-        ullog_debug("exec action output eof");
-        ullog_debug("closing fp '%p'", fp_table_item->fp);
-        if(pclose(fp_table_item->fp) == 0) {
-            task_rc = RC_SUCCESS;
-        } else {
-            task_rc = RC_FAILURE;
-        }
-        HASH_DEL(fp_table, fp_table_item);
-        free(fp_table_item);
-        if(nodeSetState(node, RC_SUCCESS)) {
-            ullog_err("cannot write node state to tree");
-            task_rc = RC_ERROR;
-            goto bail;
+
+    ullog_debug("start bte_run");
+    while ((task_rc = bte_tick(tree, 1)) == BTE_RUNNING) {
+        if (g_dump) {
+            g_dump = 0;
+            if (g_trace_file) bte_save_trace(tree, g_trace_file);
+            if (g_log_file) bte_save_log(g_log_file);
         }
-    } else {
-        ullog_debug("no exec action output eof");
-        task_rc = RC_RUNNING;
-        if (action_state) {
-            if(nodeSetState(node, RC_RUNNING)) {
-                ullog_err("cannot write node state to tree");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-        } else {
-            if(!xmlNewProp(node, (const xmlChar *) "_state_",(const xmlChar *)  "running")) {
-                ullog_err("cannot write node state value 'running'");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
+        if (bte_wait(tree, bte_timeout(tree)) < 0) {
+            task_rc = BTE_ERROR;
+            break;
         }
     }
-    ullog_debug("current exec output '%s'", exec_out_buff);
-    printf("%s", exec_out_buff);
+    ullog_debug("done bte_run rc %s", bte_rc_str(task_rc));
+    if (g_stats) {
+        bte_print_stats(tree, bte_now_ns() - start_ns);
+    }
+    if (g_state_file) {
+        bte_save_state(tree, g_state_file);
+    }
+    if (g_trace_file) {
+        bte_save_trace(tree, g_trace_file);
+    }
 
     bail:
-    print_fp_table(fp_table);
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-    if (node_id && (task_rc != RC_RUNNING)) xmlFree(node_id);
-    if (action_value) xmlFree(action_value);
-    if (action_state) xmlFree(action_state);
-    if(fp_table && fp_table_item) {
-        if(task_rc == RC_ERROR) {
-            if(fp_table_item->fp) pclose(fp_table_item->fp);
-            HASH_DEL(fp_table, fp_table_item);
-            free(fp_table_item);
-        }
-    }
+    bte_free(tree);
+    bte_cleanup();
+    ullog_debug("task_rc %s", bte_rc_str(task_rc));
 
     ullog_debug("exit");
     return task_rc;
 }
 
-static rc_t 
-processActionOpen(xmlNodePtr node) 
+// tree file run on pool
+typedef struct {
+    const char *filename;
+    bte_tree_t *tree;
+    bte_rc_t rc;
+} pool_run_t;
+
+static void
+_pool_done(void *ctx, bte_tree_t *tree, bte_rc_t rc)
+{
+    pool_run_t *run = ctx;
+
+    run->rc = rc;
+    ullog_debug("%s done rc %s", run->filename, bte_rc_str(rc));
+}
+
+/**
+ * \brief   run tree files at once on pool of threads
+ * \return:
+ *  BTE_SUCCESS - all trees succeeded
+ *  BTE_FAILURE - some tree failed
+ *  BTE_ERROR - some tree failed unexpectedly or could not run
+ */
+static bte_rc_t
+processPool(char **files, unsigned int files_n, unsigned int threads)
 {
     ullog_debug("enter");
 
-    rc_t task_rc = RC_FAILURE;
-    xmlChar *node_id = NULL;
-    xmlChar *stream_id = NULL;
-    xmlChar *action_value = NULL;
-    xmlChar *action_state = NULL;
-    fp_table_t *fp_table_item = NULL;
-    int opt = 0;
-    char **argv = NULL;
-    int argc = 0;
-    char *argvcp = NULL;
-    char *token = NULL;
-    const char delim[] = " ";
-    int i = 0;
-
-    node_id = xmlGetProp(node, (const xmlChar *) "id");
-    if (node_id && (strlen((const char *) node_id) > 0)) {
-        ullog_debug("node id '%s'", node_id);
-    } else {
-        ullog_debug("generating node id");
-        node_id = (xmlChar *) _gen_node_id();
-        if(!node_id) {
-            ullog_err("cannot generate node id");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        if(!xmlNewProp(node,  (const xmlChar *) "id", node_id)) {
-            ullog_err("cannot write node id to tree");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        ullog_debug("new generated node id '%s'", node_id);
-    }
-    print_fp_table(fp_table);
+    bte_rc_t task_rc = BTE_SUCCESS;
+    bte_pool_t *pool = NULL;
+    pool_run_t *runs = NULL;
+    long long start_ns = bte_now_ns();
+    unsigned int i = 0;
 
-    stream_id = xmlGetProp(node, (const xmlChar *) "stream_id");
-    if (stream_id && (strlen((const char *) stream_id) > 0)) {
-        ullog_debug("stream id '%s'", stream_id);
-    } else {
-        ullog_err("cannot read node stream id");
-        task_rc = RC_ERROR;
+    if ((runs = calloc(files_n, sizeof(pool_run_t))) == NULL || 
+            (pool = bte_pool_new(threads)) == NULL) {
+        ullog_err("cannot start pool");
+        task_rc = BTE_ERROR;
         goto bail;
     }
-
-    action_state = xmlGetProp(node,  (const xmlChar *) "_state_");
-    ullog_debug("action state '%s'", action_state);
-    if (action_state && 
-        (strncmp((const char *) action_state, "running", strlen("running")) == 0)) {
-        ullog_debug("action is running");
-    } else if (action_state && 
-        (strncmp((const char *) action_state, "success", strlen("success")) == 0)) {
-        ullog_debug("action is success");
-        task_rc = RC_SUCCESS;
-        goto bail;
-    } else {
-        ullog_debug("action is not set");
-        action_value = xmlNodeGetContent(node);
-        if (action_value) {
-            if (strlen((const char *) action_value) == 0) {
-                ullog_err("cannot read command value or it is empty");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-            ullog_debug("create store fp item");
-            fp_table_item = (fp_table_t *) calloc(1, sizeof(fp_table_t));
-            if(!fp_table_item) {
-                ullog_err("cannot create fp table item");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-            fp_table_item->written_bytes = 0;
-#if 0
-            //fp_table_item->write_buf[0] = '\0';
-            fp_table_item->write_buf = (char *) calloc(1, STREAM_BUF_SIZE);
-            if(!fp_table_item->write_buf) {
-                ullog_err("cannot create fp table write buf");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-#endif
-
-            ullog_debug("action value '%s'", action_value);
-            argvcp = strdup((const char *) action_value);
-            token = strtok(argvcp, delim);
-            while (token != NULL) {
-                argv = (char **) realloc(argv, (argc + 1) * sizeof(char *));
-                argv[argc] = (char *) calloc(255, sizeof(char));
-                snprintf(argv[argc], 255, "%s", token);
-                token = strtok(NULL, delim);
-                ++argc;
-            }
-            argv = (char **) realloc(argv, (argc + 1) * sizeof(char *));
-            argv[argc] = (char *) NULL;
-
-            if(g_expect_debug) {
-                exp_is_debugging = 1;
-                exp_loguser = 1;
-                exp_timeout = 0; // return immediately
-            }
-
-            if(!(fp_table_item->fd = exp_spawnv(argv[0], (char **) argv))) {
-                ullog_err("cannot execute command '%s'", action_value);
-                task_rc = RC_FAILURE;
-                goto bail;
-            }
-            if(fp_table_item->fd < 1) {
-                ullog_err("cannot open stream for command '%s'", action_value);
-                task_rc = RC_FAILURE;
-                goto bail;
-            }
-
-            opt = fcntl(fp_table_item->fd, F_GETFL);
-            if (opt < 0) {
-                ullog_err("cannot F_GETFL on open command '%s'", action_value);
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            opt |= O_NONBLOCK;
-            if (fcntl(fp_table_item->fd, F_SETFL, opt) < 0) {
-                ullog_err("cannot F_SETFL on open command '%s'", action_value);
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            FD_ZERO(&(fp_table_item->fds));
-            FD_SET(fp_table_item->fd, &(fp_table_item->fds));
-
-            task_rc = RC_SUCCESS;
-
-            ullog_debug("start store fp in fp table");
-            fp_table_item->id = (const char *) stream_id;
-            ullog_debug("id '%s'", fp_table_item->id);
-            ullog_debug("fp '%p'", fp_table_item->fp);
-            ullog_debug("fd '%d'", fp_table_item->fd);
-            HASH_ADD_KEYPTR(hh, fp_table, fp_table_item->id, 
-                    strlen(fp_table_item->id), fp_table_item);
-            ullog_debug("done store fp in fp table");
-            if(nodeSetState(node, RC_SUCCESS)) {
-                ullog_err("cannot write node state to tree");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            sleep(1);
-        } else {
-            ullog_err("cannot read command value or it is empty");
-            task_rc = RC_ERROR;
-            goto bail;
+    for (i = 0; i < files_n; ++i) {
+        runs[i].filename = files[i];
+        runs[i].rc = BTE_ERROR;
+        if ((runs[i].tree = bte_load_file(files[i])) == NULL || 
+                bte_pool_submit(pool, runs[i].tree, _pool_done, &runs[i])) {
+            ullog_err("cannot run %s", files[i]);
         }
     }
-
-    if(!fp_table_item) {
-        ullog_debug("search fp_table_item");
-        HASH_FIND_STR(fp_table, (const char *) stream_id, fp_table_item);
-    }
-    ullog_debug("stream_id '%p'", stream_id);
-    ullog_debug("fp_table '%p'", fp_table);
-    ullog_debug("fp_table_item '%p'", fp_table_item);
-    if(!fp_table_item) {
-        ullog_err("cannot find open stream id for node id '%s'", node_id);
-        task_rc = RC_ERROR;
-        goto bail;
+    bte_pool_wait(pool);
+    for (i = 0; i < files_n; ++i) {
+        // worst result, errors last
+        if (runs[i].rc > task_rc) {
+            task_rc = runs[i].rc;
+        }
+        if (g_stats && runs[i].tree) {
+            fprintf(stderr, "stats: file %s rc %s\n", runs[i].filename, 
+                    bte_rc_str(runs[i].rc));
+            bte_print_stats(runs[i].tree, bte_now_ns() - start_ns);
+        }
     }
 
     bail:
-    print_fp_table(fp_table);
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-    //if (node_id && (task_rc != RC_RUNNING)) xmlFree(node_id);
-    //if (stream_id && (task_rc != RC_RUNNING)) xmlFree(stream_id);
-    if (action_value) xmlFree(action_value);
-    if (action_state) xmlFree(action_state);
-    if(fp_table && fp_table_item) {
-        if(task_rc == RC_ERROR) {
-            if(fp_table_item->fd) close(fp_table_item->fd);
-            HASH_DEL(fp_table, fp_table_item);
-            free(fp_table_item);
-        }
-    }
-    if(argc && argv) {
-        for (i = 0; i < argc; ++i) {
-            if(argv[i]) free(argv[i]);
-        }
-        free(argv);
+    bte_pool_free(pool);
+    for (i = 0; runs && i < files_n; ++i) {
+        bte_free(runs[i].tree);
     }
+    if (runs) free(runs);
+    bte_cleanup();
 
     ullog_debug("exit");
     return task_rc;
 }
 
-static rc_t 
-processActionClose(xmlNodePtr node) 
+/**
+ * \brief   compile tree file into binary image, 
+ *  image of tree.xml is tree.bteb unless out is given
+ * \return:
+ *  BTE_SUCCESS - image is written
+ *  BTE_ERROR - error
+ */
+static bte_rc_t
+compileFile(const char *filename, const char *out)
 {
     ullog_debug("enter");
 
-    rc_t task_rc = RC_FAILURE;
-    xmlChar *node_id = NULL;
-    xmlChar *stream_id = NULL;
-    xmlChar *action_value = NULL;
-    xmlChar *action_state = NULL;
-    fp_table_t *fp_table_item = NULL;
+    bte_rc_t task_rc = BTE_SUCCESS;
+    char path[PATH_MAX] = "";
+    size_t len = strlen(filename);
 
-    node_id = xmlGetProp(node, (const xmlChar *) "id");
-    if (node_id && (strlen((const char *) node_id) > 0)) {
-        ullog_debug("node id '%s'", node_id);
-    } else {
-        ullog_debug("generating node id");
-        node_id = (xmlChar *) _gen_node_id();
-        if(!node_id) {
-            ullog_err("cannot generate node id");
-            task_rc = RC_ERROR;
-            goto bail;
+    if (!out) {
+        if (len > 4 && strcmp(filename + len - 4, ".xml") == 0) {
+            len -= 4;
         }
-        if(!xmlNewProp(node,  (const xmlChar *) "id", node_id)) {
-            ullog_err("cannot write node id to tree");
-            task_rc = RC_ERROR;
+        if (len + sizeof(".bteb") > sizeof(path)) {
+            ullog_err("path %s is too long", filename);
+            task_rc = BTE_ERROR;
             goto bail;
         }
-        ullog_debug("new generated node id '%s'", node_id);
+        memcpy(path, filename, len);
+        strcpy(path + len, ".bteb");
+        out = path;
     }
-    print_fp_table(fp_table);
-
-    stream_id = xmlGetProp(node, (const xmlChar *) "stream_id");
-    if (stream_id && (strlen((const char *) stream_id) > 0)) {
-        ullog_debug("stream id '%s'", stream_id);
-    } else {
-        ullog_err("cannot read node stream id");
-        task_rc = RC_ERROR;
-        goto bail;
-    }
-
-    action_state = xmlGetProp(node,  (const xmlChar *) "_state_");
-    ullog_debug("action state '%s'", action_state);
-    if (action_state && 
-        (strncmp((const char *) action_state, "running", strlen("running")) == 0)) {
-        ullog_debug("action is running");
-    } else if (action_state && 
-        (strncmp((const char *) action_state, "success", strlen("success")) == 0)) {
-        ullog_debug("action is success");
-        task_rc = RC_SUCCESS;
-        goto bail;
-    } else {
-        ullog_debug("action is not set");
-        action_value = xmlNodeGetContent(node);
-        if (action_value) {
-// no values in close action            
-#if 0
-            _trimwhitespace((char *) action_value);
-            if (strlen((const char *) action_value) == 0) {
-                ullog_err("cannot read command value or it is empty");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            ullog_debug("action value '%s'", action_value);
-            strncat(exec_path, (const char *) action_value, PATH_MAX);
-#endif
-
-            if(!fp_table_item) {
-                ullog_debug("search fp_table_item");
-                HASH_FIND_STR(fp_table, (const char *) stream_id, fp_table_item);
-            }
-            ullog_debug("stream_id '%p'", stream_id);
-            ullog_debug("fp_table '%p'", fp_table);
-            ullog_debug("fp_table_item '%p'", fp_table_item);
-            if(!fp_table_item) {
-                ullog_err("cannot find open stream id for node id '%s'", node_id);
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-            task_rc = RC_SUCCESS;
-            if(fp_table_item->fd) {
-                errno = 0;
-                if(close(fp_table_item->fd)) {
-                    task_rc = RC_FAILURE;
-                }
-                FD_ZERO(&(fp_table_item->fds));
-            }
-
-            HASH_DEL(fp_table, fp_table_item);
-            free(fp_table_item);
-            if(nodeSetState(node, RC_SUCCESS)) {
-                ullog_err("cannot write node state to tree");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-        } else {
-            ullog_err("cannot read command value or it is empty");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
+    if (bte_compile(filename, out)) {
+        task_rc = BTE_ERROR;
     }
+    bte_cleanup();
 
     bail:
-    print_fp_table(fp_table);
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-    if (node_id && (task_rc != RC_RUNNING)) xmlFree(node_id);
-    if (stream_id && (task_rc != RC_RUNNING)) xmlFree(stream_id);
-    if (action_value) xmlFree(action_value);
-    if (action_state) xmlFree(action_state);
-    if(fp_table && fp_table_item) {
-        if(task_rc == RC_ERROR) {
-            if(fp_table_item->fd) close(fp_table_item->fd);
-            HASH_DEL(fp_table, fp_table_item);
-            free(fp_table_item);
-        }
-    }
-
     ullog_debug("exit");
     return task_rc;
 }
 
-static rc_t 
-processActionExpect(xmlNodePtr node) 
+/**
+ * \brief   send queued frames to client until its socket is full
+ * \return:
+ *  0 - success
+ *  -1 - client is gone
+ */
+static int
+sessionFlush(session_t *ss)
 {
-    ullog_debug("enter");
-
-    rc_t task_rc = RC_FAILURE;
-    xmlChar *node_id = NULL;
-    xmlChar *stream_id = NULL;
-    xmlChar *action_value = NULL;
-    xmlChar *action_state = NULL;
-    fp_table_t *fp_table_item = NULL;
-    int rc = 0;
-    struct timeval tv;
-    int select_rc = -1;
+    ssize_t n = 0;
 
-    node_id = xmlGetProp(node, (const xmlChar *) "id");
-    if (node_id && (strlen((const char *) node_id) > 0)) {
-        ullog_debug("node id '%s'", node_id);
-    } else {
-        ullog_debug("generating node id");
-        node_id = (xmlChar *) _gen_node_id();
-        if(!node_id) {
-            ullog_err("cannot generate node id");
-            task_rc = RC_ERROR;
-            goto bail;
+    while (!ss->broken && ss->out_off < ss->out_n) {
+        n = write(ss->fd, ss->out + ss->out_off, ss->out_n - ss->out_off);
+        if (n < 0 && errno == EINTR) {
+            continue;
         }
-        if(!xmlNewProp(node,  (const xmlChar *) "id", node_id)) {
-            ullog_err("cannot write node id to tree");
-            task_rc = RC_ERROR;
-            goto bail;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
         }
-        ullog_debug("new generated node id '%s'", node_id);
+        if (n <= 0) {
+            ullog_debug("cannot write output to fd %d: %s", ss->fd, strerror(errno));
+            ss->broken = 1;
+            break;
+        }
+        ss->out_off += n;
     }
-    print_fp_table(fp_table);
+    // drop sent bytes, also all of them when nobody reads
+    ss->out_n = ss->broken ? 0 : ss->out_n - ss->out_off;
+    memmove(ss->out, ss->out + ss->out_off, ss->out_n);
+    ss->out_off = 0;
+    return ss->broken ? -1 : 0;
+}
 
-    stream_id = xmlGetProp(node, (const xmlChar *) "stream_id");
-    if (stream_id && (strlen((const char *) stream_id) > 0)) {
-        ullog_debug("stream id '%s'", stream_id);
-    } else {
-        ullog_err("cannot read node stream id");
-        task_rc = RC_ERROR;
-        goto bail;
-    }
+/**
+ * \brief   queue frame for client and send what socket takes now
+ */
+static void
+sessionQueue(session_t *ss, const char *head, const char *buf, size_t len)
+{
+    size_t head_len = strlen(head);
 
-    action_state = xmlGetProp(node,  (const xmlChar *) "_state_");
-    ullog_debug("action state '%s'", action_state);
-    if (action_state && 
-        (strncmp((const char *) action_state, "running", strlen("running")) == 0)) {
-        ullog_debug("action is running");
-    } else if (action_state && 
-        (strncmp((const char *) action_state, "success", strlen("success")) == 0)) {
-        ullog_debug("action is success");
-        task_rc = RC_SUCCESS;
-        goto bail;
+    if (ss->broken) {
+        return;
     }
-
-    action_value = xmlNodeGetContent(node);
-    if (action_value) {
-        if (strlen((const char *) action_value) == 0) {
-            ullog_err("cannot read command value or it is empty");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        ullog_debug("action value '%s'", action_value);
-
-        if(!fp_table_item) {
-            ullog_debug("search fp_table_item");
-            HASH_FIND_STR(fp_table, (const char *) stream_id, fp_table_item);
-        }
-        ullog_debug("stream_id p '%p'", stream_id);
-        ullog_debug("stream_id '%s'", stream_id);
-        ullog_debug("fp_table '%p'", fp_table);
-        ullog_debug("fp_table_item '%p'", fp_table_item);
-        if(!fp_table_item) {
-            ullog_err("cannot find open stream id for node id '%s'", node_id);
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        if(fp_table_item->fd < 1) {
-            ullog_err("stream id is not opened for node id '%s'", node_id);
-            task_rc = RC_FAILURE;
-            goto bail;
-        }
-
-        // wait for data for reading
-        // no blocking
-        tv.tv_sec = 0;
-        tv.tv_usec = SELECT_SLEEP_USEC;
-        errno = 0;
-        select_rc = select(fp_table_item->fd + 1, &(fp_table_item->fds), NULL, NULL, &tv);
-        ullog_debug("read stream id '%s' rc %d", node_id, select_rc);
-        if(select_rc == -1) {
-            ullog_debug("stream id '%s' select error error '%s'", 
-                    node_id, strerror(errno));
-            task_rc = RC_FAILURE;
-            goto bail;
-        } else if (select_rc == 0) {
-            ullog_debug("stream id '%s' select timeout", node_id);
-            if(nodeSetState(node, RC_RUNNING)) {
-                ullog_err("cannot write node state to tree");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            task_rc = RC_RUNNING;
-            goto bail;
-        } 
-        ullog_debug("start reading stream id '%s'", node_id);
-
-        // do actual action
-        errno = 0;
-        ullog_debug("df '%d' exp_regexp '%d' action_value '%s' exp_end %d", 
-                fp_table_item->fd, exp_regexp, action_value, exp_end);
-        rc = exp_expectl(fp_table_item->fd, exp_glob, action_value, 1, 
-                exp_end);
-        //ullog_debug("rc '%d' error '%s'", rc, strerror(errno));
-        ullog_debug("rc '%d' buffer '%s' matched '%s' error '%s'", 
-            rc, exp_buffer, exp_match, strerror(errno));
-        if(rc == 1) {
-            ullog_debug("MATCHED");
-            if(nodeSetState(node, RC_SUCCESS)) {
-                ullog_err("cannot write node state to tree");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            task_rc = RC_SUCCESS;
-        } else if(rc == EXP_ABEOF) {
-            if(errno == EAGAIN) {
-                ullog_debug("not ready: keep running");
-                if(nodeSetState(node, RC_RUNNING)) {
-                    ullog_err("cannot write node state to tree");
-                    task_rc = RC_ERROR;
-                    goto bail;
-                }
-                task_rc = RC_RUNNING;
-            } else {
-                ullog_err("stream I/O error: %s", strerror(errno));
-                task_rc = RC_FAILURE;
-            }
-#if 0
-        } else if(rc == EXP_TIMEOUT) {
-            ullog_debug("expect timeout: keep running");
-            if(nodeSetState(node, RC_RUNNING)) {
-                ullog_err("cannot write node state to tree");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-            task_rc = RC_RUNNING;
-#endif
-        } else {
-            ullog_debug("not matched error: %s", strerror(errno));
-            task_rc = RC_FAILURE;
-        }
-
-
-    } else {
-        ullog_err("cannot read command value or it is empty");
-        task_rc = RC_ERROR;
-        goto bail;
+    if (_grow((void **) &ss->out, &ss->out_size, ss->out_n + head_len + len, 1)) {
+        ullog_err("cannot queue output of fd %d", ss->fd);
+        ss->broken = 1;
+        return;
     }
+    memcpy(ss->out + ss->out_n, head, head_len);
+    memcpy(ss->out + ss->out_n + head_len, buf, len);
+    ss->out_n += head_len + len;
+    sessionFlush(ss);
+}
 
-    //if(g_debug) sleep(1);
-
-    bail:
-    print_fp_table(fp_table);
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-    //if (node_id && (task_rc != RC_RUNNING)) xmlFree(node_id);
-    //if (stream_id&& (task_rc != RC_RUNNING) ) xmlFree(stream_id);
-    if (action_value) xmlFree(action_value);
-    if (action_state) xmlFree(action_state);
-    if(fp_table && fp_table_item) {
-        if(task_rc == RC_ERROR) {
-            if(fp_table_item->fd) close(fp_table_item->fd);
-            HASH_DEL(fp_table, fp_table_item);
-            free(fp_table_item);
-        }
-    }
+/**
+ * \brief   send tree output to client in out frame
+ */
+static void
+_session_output(void *ctx, const char *buf, size_t len)
+{
+    session_t *ss = ctx;
+    char head[32] = "";
 
-    ullog_debug("exit");
-    return task_rc;
+    snprintf(head, sizeof(head), "out %zu\n", len);
+    sessionQueue(ss, head, buf, len);
 }
 
-static rc_t 
-processActionWrite(xmlNodePtr node) 
+/**
+ * \brief   load tree of session from request, 
+ *  request is "path <file>\n" or "xml\n" followed by document
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+sessionLoad(session_t *ss)
 {
     ullog_debug("enter");
 
-    rc_t task_rc = RC_FAILURE;
-    xmlChar *node_id = NULL;
-    xmlChar *stream_id = NULL;
-    xmlChar *action_value = NULL;
-    xmlChar *action_state = NULL;
-    fp_table_t *fp_table_item = NULL;
-    int n = 0;
-    int select_rc = -1;
-    struct timeval tv;
-
-    node_id = xmlGetProp(node, (const xmlChar *) "id");
-    if (node_id && (strlen((const char *) node_id) > 0)) {
-        ullog_debug("node id '%s'", node_id);
-    } else {
-        ullog_debug("generating node id");
-        node_id = (xmlChar *) _gen_node_id();
-        if(!node_id) {
-            ullog_err("cannot generate node id");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        if(!xmlNewProp(node,  (const xmlChar *) "id", node_id)) {
-            ullog_err("cannot write node id to tree");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        ullog_debug("new generated node id '%s'", node_id);
-    }
-    print_fp_table(fp_table);
+    int rc = 0;
+    char *eol = NULL;
 
-    stream_id = xmlGetProp(node, (const xmlChar *) "stream_id");
-    if (stream_id && (strlen((const char *) stream_id) > 0)) {
-        ullog_debug("stream id '%s'", stream_id);
-    } else {
-        ullog_err("cannot read node stream id");
-        task_rc = RC_ERROR;
+    if ((eol = memchr(ss->req, '\n', ss->req_n)) == NULL) {
+        ullog_err("request has no header");
+        rc = -1;
         goto bail;
     }
-
-    action_state = xmlGetProp(node,  (const xmlChar *) "_state_");
-    ullog_debug("action state '%s'", action_state);
-    if (action_state && 
-        (strncmp((const char *) action_state, "running", strlen("running")) == 0)) {
-        ullog_debug("action is running");
-    } else if (action_state && 
-        (strncmp((const char *) action_state, "success", strlen("success")) == 0)) {
-        ullog_debug("action is success");
-        task_rc = RC_SUCCESS;
-        goto bail;
+    *eol = '\0';
+    if (strncmp(ss->req, "path ", 5) == 0) {
+        ullog_debug("read file %s", ss->req + 5);
+        ss->tree = bte_load_file(ss->req + 5);
+    } else if (strcmp(ss->req, "xml") == 0) {
+        ullog_debug("read %zu bytes of xml", ss->req_n - (eol + 1 - ss->req));
+        ss->tree = bte_load_memory(eol + 1, ss->req_n - (eol + 1 - ss->req));
     } else {
-        ullog_debug("action is not set");
-        action_value = xmlNodeGetContent(node);
-        if (action_value) {
-            if (strlen((const char *) action_value) == 0) {
-                ullog_err("cannot read command value or it is empty");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-#if 0            
-            ullog_debug("create store fp item");
-            fp_table_item = (fp_table_t *) malloc(sizeof(fp_table_t));
-            if(!fp_table_item) {
-                ullog_err("cannot create fp table item");
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-
-            ullog_debug("start store fp in fp table");
-            fp_table_item->id = (const char *) node_id;
-            ullog_debug("id '%s'", fp_table_item->id);
-            ullog_debug("fp '%p'", fp_table_item->fp);
-            HASH_ADD_KEYPTR(hh, fp_table, 
-            fp_table_item->id, strlen(fp_table_item->id), fp_table_item);
-            ullog_debug("done store fp in fp table");
-#endif
-            if(!fp_table_item) {
-                ullog_debug("search fp_table_item");
-                HASH_FIND_STR(fp_table, (const char *) stream_id, fp_table_item);
-            }
-            ullog_debug("node_id '%p'", node_id);
-            ullog_debug("stream_id '%p'", stream_id);
-            ullog_debug("fp_table '%p'", fp_table);
-            ullog_debug("fp_table_item '%p'", fp_table_item);
-            if(!fp_table_item) {
-                ullog_err("cannot find open fp for node id '%s'", node_id);
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-
-            ullog_debug("set action value '%s'", action_value);
-            memset(fp_table_item->write_buf, 0, STREAM_BUF_SIZE);
-            snprintf(fp_table_item->write_buf, STREAM_BUF_SIZE, "%s", 
-                    (const char *) action_value);
-            //strcpy(fp_table_item->write_buf, (const char *) action_value);
-            //strcpy(fp_table_item->write_buf, "pwd");
-
-        } else {
-            ullog_err("cannot read command value or it is empty");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-    }
-
-
-    if(!fp_table_item) {
-        ullog_debug("search fp_table_item");
-        HASH_FIND_STR(fp_table, (const char *) stream_id, fp_table_item);
-    }
-    if(!fp_table_item) {
-        ullog_err("cannot find open stream id for node id '%s'", node_id);
-        task_rc = RC_ERROR;
-        goto bail;
-    }
-    if(fp_table_item->fd < 1) {
-        ullog_err("stream id is not opened for node id '%s'", node_id);
-        task_rc = RC_FAILURE;
+        ullog_err("request '%s' is not supported", ss->req);
+        rc = -1;
         goto bail;
     }
-    ullog_debug("stream_id '%p'", stream_id);
-    ullog_debug("fp_table '%p'", fp_table);
-    ullog_debug("fp_table_item '%p'", fp_table_item);
-    ullog_debug("write buf '%s'", fp_table_item->write_buf);
-
-    // wait for data for writing
-    // no blocking
-    tv.tv_sec = 0;
-    tv.tv_usec = SELECT_SLEEP_USEC;
-    errno = 0;
-    select_rc = select(fp_table_item->fd + 1, NULL, &(fp_table_item->fds), 
-            NULL, &tv);
-    if(select_rc == -1) {
-        ullog_debug("stream id '%s' select error error '%s'",
-                node_id, strerror(errno));
-        task_rc = RC_FAILURE;
-        goto bail;
-    } else if (select_rc == 0) {
-        ullog_debug("stream id '%s' select timeout", node_id);
-        if(nodeSetState(node, RC_RUNNING)) {
-            ullog_err("cannot write node state to tree");
-            task_rc = RC_ERROR;
-            goto bail;
-        }
-        task_rc = RC_RUNNING;
+    if (ss->tree == NULL) {
+        ullog_err("unable to load tree of request '%s'", ss->req);
+        rc = -1;
         goto bail;
     }
-    ullog_debug("start writing to stream id '%s'", node_id);
-
-    // start do actual action
-    n = async_write_chunk(fp_table_item->fd, 
-        fp_table_item->write_buf + fp_table_item->written_bytes, 
-        (strlen(fp_table_item->write_buf) > STREAM_CHUNK_SIZE) ? 
-        STREAM_CHUNK_SIZE : strlen(fp_table_item->write_buf));
-    //ullog_debug("async_write: n %d chunk '%s' buf '%s' total written %d", 
-    //        n, fp_table_item->write_buf[fp_table_item->written_bytes], 
-    //        fp_table_item->write_buf, fp_table_item->written_bytes);
-
-    if (n > 0) {
-        ullog_debug("async_write: got chunk of written");
-        fp_table_item->written_bytes += n;
-        task_rc = RC_RUNNING;
-        //if(g_debug) sleep(1);
-    } else if (n == -1) {
-        ullog_err("async_write: error writing chunk");
-        fp_table_item->written_bytes = -1;
-        task_rc = RC_FAILURE;
-    } else if (n == -2) {
-        ullog_debug("async_write: keep writting chunk\n");
-    }
-    if (fp_table_item->written_bytes >= strlen(fp_table_item->write_buf)) {
-        fp_table_item->written_bytes = 0;
-        ullog_debug("async_write: finished writing buffer\n");
-        task_rc = RC_SUCCESS;
-        sleep(1);
-    }
-    // finish do actual action
+    bte_set_output(ss->tree, _session_output, ss);
 
     bail:
-    print_fp_table(fp_table);
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-    //if (node_id && (task_rc != RC_RUNNING)) xmlFree(node_id);
-    //if (stream_id&& (task_rc != RC_RUNNING) ) xmlFree(stream_id);
-    if (action_value) xmlFree(action_value);
-    if (action_state) xmlFree(action_state);
-    if(fp_table && fp_table_item) {
-        if(task_rc != RC_RUNNING) {
-            //HASH_DEL(fp_table, fp_table_item);
-            //free(fp_table_item);
-        }
-    }
-    if(nodeSetState(node, task_rc)) {
-        ullog_err("cannot write node state to tree");
-        task_rc = RC_ERROR;
-    }
-
     ullog_debug("exit");
-    return task_rc;
+    return rc;
 }
 
-static rc_t
-processActionLeaf(xmlNodePtr node)
+/**
+ * \brief   free tree of session and queue its result for client
+ */
+static void
+sessionEnd(session_t *ss, bte_rc_t task_rc)
 {
-    ullog_debug("enter");
+    char tail[32] = "";
 
-    rc_t task_rc = RC_FAILURE;
-    xmlNodePtr cur_node = NULL;
-
-    for (cur_node = node->children; cur_node; cur_node = cur_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-            if (xmlStrcmp(cur_node->name, (const xmlChar *) "exec") == 0) {
-                ullog_debug("action node address '%p'", cur_node);
-                task_rc = processActionExec(cur_node);
-                break;
-            } else if (xmlStrcmp(cur_node->name, (const xmlChar *) "open") == 0) {
-                ullog_debug("action node address '%p'", cur_node);
-                task_rc = processActionOpen(cur_node);
-                break;
-            } else if (xmlStrcmp(cur_node->name, (const xmlChar *) "close") == 0) {
-                ullog_debug("action node address '%p'", cur_node);
-                task_rc = processActionClose(cur_node);
-                break;
-            } else if (xmlStrcmp(cur_node->name, (const xmlChar *) "expect") == 0) {
-                ullog_debug("action node address '%p'", cur_node);
-                task_rc = processActionExpect(cur_node);
-                break;
-            } else if (xmlStrcmp(cur_node->name, (const xmlChar *) "write") == 0) {
-                ullog_debug("action node address '%p'", cur_node);
-                task_rc = processActionWrite(cur_node);
-                break;
-            } else {
-                ullog_err("node '%s' is not supported", cur_node->name);
-                _xmlDump(cur_node, 0);
-                task_rc = RC_ERROR;
-                goto bail;
-            }
-        }
+    ullog_debug("session fd %d ends with %s", ss->fd, bte_rc_str(task_rc));
+    if (ss->tree) {
+        bte_halt(ss->tree);
     }
+    bte_free(ss->tree);
+    ss->tree = NULL;
+    ss->done = 1;
+    snprintf(tail, sizeof(tail), "rc %s\n", bte_rc_str(task_rc));
+    sessionQueue(ss, tail, "", 0);
+}
 
-    bail:
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-
-    ullog_debug("exit");
-    return task_rc;
+static void
+sessionFree(session_t *ss)
+{
+    close(ss->fd);
+    bte_free(ss->tree);
+    if (ss->req) free(ss->req);
+    if (ss->out) free(ss->out);
+    free(ss);
 }
 
-static rc_t 
-processDecoratorNode(xmlNodePtr node) 
+/**
+ * \brief   read request of session
+ * \return:
+ *  1 - request is complete
+ *  0 - need more data
+ *  -1 - error
+ */
+static int
+sessionRead(session_t *ss)
 {
-    ullog_debug("enter");
+    ssize_t n = 0;
 
-    rc_t task_rc = RC_SUCCESS;
-    xmlChar *node_type = NULL;
-
-    if (node->type == XML_ELEMENT_NODE) {
-        ullog_debug("element node '%s'", node->name);
-        node_type = xmlGetProp(node, (const xmlChar *) "type");
-        if (node_type && (strlen((const char *) node_type) > 0)) {
-            ullog_debug("node type '%s'", node_type);
-        } else {
-            ullog_err("node '%s' is not supported", node->name);
-            _xmlDump(node, 0);
-            task_rc = RC_ERROR;
-            goto bail;
+    for (;;) {
+        if (_grow((void **) &ss->req, &ss->req_size, ss->req_n + 4096, 1)) {
+            ullog_err("cannot allocate request");
+            return -1;
         }
-
-        if (xmlStrcmp(node_type, (const xmlChar *) "succeeder") == 0) {
-            ullog_debug("decorator node type is succeeder");
-            task_rc = processDecoratorSucceederNode(node);
-        } else {
-            ullog_err("node '%s' is not supported", node->name);
-            _xmlDump(node, 0);
-            task_rc = RC_ERROR;
-            goto bail;
+        n = read(ss->fd, ss->req + ss->req_n, ss->req_size - ss->req_n - 1);
+        if (n > 0) {
+            ss->req_n += n;
+            ss->req[ss->req_n] = '\0';
+            continue;
         }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ullog_err("cannot read request: %s", strerror(errno));
+            return -1;
+        }
+        break;
     }
-
-    bail:
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-    if (node_type) xmlFree(node_type);
-
-    ullog_debug("exit");
-    return task_rc;
+    // path request ends with line, xml request ends with end of input
+    if (n == 0) {
+        return 1;
+    }
+    if (ss->req_n > 5 && strncmp(ss->req, "path ", 5) == 0 && 
+            memchr(ss->req, '\n', ss->req_n)) {
+        return 1;
+    }
+    return 0;
 }
 
-static rc_t 
-processDecoratorSucceederNode(xmlNodePtr node)
-{
-    ullog_debug("enter");
-
-    rc_t task_rc = RC_SUCCESS;
-    xmlNodePtr cur_node = NULL;
+static volatile sig_atomic_t g_serve_stop = 0;
 
-    for (cur_node = node->children; cur_node; cur_node = cur_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-            task_rc = processNode(cur_node);
-            if (task_rc == RC_FAILURE) {
-                task_rc = RC_SUCCESS;
-            }
-            break;
-        }
-    }
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-
-    ullog_debug("exit");
-    return task_rc;
+static void
+_serve_stop(int sig)
+{
+    g_serve_stop = 1;
 }
 
-static rc_t 
-processSequenceNode(xmlNodePtr node)
+/**
+ * \brief   accept trees on unix socket and run them in one event loop, 
+ *  output of each tree is streamed back in out frames and 
+ *  its result is sent in last rc line
+ * \return:
+ *  BTE_SUCCESS - server stopped by signal
+ *  BTE_ERROR - server failed
+ */
+static bte_rc_t
+serveSocket(const char *path)
 {
     ullog_debug("enter");
 
-    rc_t task_rc = RC_SUCCESS;
-    xmlNodePtr cur_node = NULL;
+    bte_rc_t task_rc = BTE_SUCCESS;
+    int lfd = -1;
+    int fd = -1;
+    struct sockaddr_un addr;
+    session_t *sessions = NULL;
+    session_t *ss = NULL;
+    session_t **pss = NULL;
+    struct pollfd *pfds = NULL;
+    size_t pfds_size = 0;
+    unsigned int pfds_n = 0;
+    long long timeout = -1;
+    long long t = 0;
+    unsigned int i = 0;
+    unsigned int n = 0;
+    int rc = 0;
 
-    for (cur_node = node; cur_node; cur_node = cur_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-            task_rc = processNode(cur_node);
-            if (task_rc == RC_FAILURE || task_rc == RC_ERROR || task_rc == RC_RUNNING) {
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, _serve_stop);
+    signal(SIGTERM, _serve_stop);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // socket is bound aside and renamed once listening, 
+    // so client finding path never gets refused
+    if (snprintf(addr.sun_path, sizeof(addr.sun_path), "%s.tmp", path) >= 
+            (int) sizeof(addr.sun_path)) {
+        ullog_err("socket path %s is too long", path);
+        task_rc = BTE_ERROR;
+        goto bail;
+    }
+    unlink(addr.sun_path);
+    if ((lfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || 
+            bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) || 
+            listen(lfd, SOMAXCONN) || _set_nonblock(lfd) || 
+            rename(addr.sun_path, path)) {
+        ullog_err("cannot listen on %s: %s", path, strerror(errno));
+        unlink(addr.sun_path);
+        if (lfd >= 0) close(lfd);
+        lfd = -1;
+        task_rc = BTE_ERROR;
+        goto bail;
+    }
+    fcntl(lfd, F_SETFD, FD_CLOEXEC);
+    ullog_info("serving on %s", path);
+
+    while (!g_serve_stop) {
+        // listening socket, clients sending requests and running trees
+        pfds_n = 0;
+        timeout = -1;
+        for (ss = sessions; ; ss = ss->next) {
+            if (_grow((void **) &pfds, &pfds_size, pfds_n + 1, sizeof(struct pollfd))) {
+                ullog_err("cannot allocate poll fds");
+                task_rc = BTE_ERROR;
                 goto bail;
             }
+            if (!ss) {
+                pfds[pfds_n].fd = lfd;
+                pfds[pfds_n++].events = POLLIN;
+                break;
+            }
+            ss->pfd = pfds_n;
+            ss->pfd_n = 0;
+            ss->ready = 0;
+            if (ss->out_n) {
+                // client fd comes first while output waits for it
+                pfds[pfds_n].fd = ss->fd;
+                pfds[pfds_n++].events = POLLOUT;
+            }
+            if (ss->done || ss->out_n >= SERVE_OUT_MAX) {
+                // tree of slow client waits until client reads
+                ss->pfd_n = pfds_n - ss->pfd;
+                continue;
+            }
+            if (!ss->running) {
+                pfds[pfds_n].fd = ss->fd;
+                pfds[pfds_n++].events = POLLIN;
+                ss->pfd_n = pfds_n - ss->pfd;
+                continue;
+            }
+            t = bte_timeout(ss->tree);
+            if (t >= 0 && (timeout < 0 || t < timeout)) timeout = t;
+            if ((fd = bte_fd(ss->tree)) >= 0) {
+                pfds[pfds_n].fd = fd;
+                pfds[pfds_n++].events = POLLIN;
+            } else {
+                // no pollable fd of tree, poll fds of its nodes
+                n = bte_pollfds(ss->tree, NULL, 0);
+                if (_grow((void **) &pfds, &pfds_size, pfds_n + n + 1, 
+                            sizeof(struct pollfd))) {
+                    ullog_err("cannot allocate poll fds");
+                    task_rc = BTE_ERROR;
+                    goto bail;
+                }
+                pfds_n += bte_pollfds(ss->tree, pfds + pfds_n, n);
+            }
+            ss->pfd_n = pfds_n - ss->pfd;
         }
-    }
-
-    bail:
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-
-    ullog_debug("exit");
-    return task_rc;
-}
 
-static rc_t 
-processSelectNode(xmlNodePtr node) 
-{
-    ullog_debug("enter");
-
-    rc_t task_rc = RC_SUCCESS;
-    xmlNodePtr cur_node = NULL;
+        rc = poll(pfds, pfds_n, (int) timeout);
+        if (rc < 0 && errno != EINTR) {
+            ullog_err("poll failed: %s", strerror(errno));
+            task_rc = BTE_ERROR;
+            goto bail;
+        }
+        if (g_dump) {
+            g_dump = 0;
+            if (g_log_file) bte_save_log(g_log_file);
+        }
+        for (ss = sessions; rc > 0 && ss; ss = ss->next) {
+            for (i = ss->pfd + (ss->out_n ? 1 : 0); i < ss->pfd + ss->pfd_n; ++i) {
+                if (pfds[i].revents) ss->ready = 1;
+            }
+        }
 
-    for (cur_node = node; cur_node; cur_node = cur_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-            task_rc = processNode(cur_node);
-            if (task_rc == RC_SUCCESS || task_rc == RC_ERROR) {
-                goto bail;
+        // new clients
+        if (rc > 0 && pfds[pfds_n - 1].revents) {
+            while ((fd = accept(lfd, NULL, NULL)) >= 0) {
+                if ((ss = calloc(1, sizeof(session_t))) == NULL) {
+                    ullog_err("cannot allocate session");
+                    close(fd);
+                    continue;
+                }
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                _set_nonblock(fd);
+                ss->fd = fd;
+                ss->next = sessions;
+                sessions = ss;
+                ullog_debug("new session fd %d", fd);
+            }
+        }
+
+        for (pss = &sessions; (ss = *pss) != NULL; ) {
+            task_rc = BTE_RUNNING;
+            if (ss->done || ss->out_n >= SERVE_OUT_MAX) {
+                // only output is sent
+            } else if (!ss->running && ss->ready) {
+                rc = sessionRead(ss);
+                if (rc < 0) {
+                    task_rc = BTE_ERROR;
+                } else if (rc > 0) {
+                    if (sessionLoad(ss)) {
+                        task_rc = BTE_ERROR;
+                    } else {
+                        ss->running = 1;
+                        task_rc = bte_tick(ss->tree, SERVE_TICK_BUDGET);
+                    }
+                }
+            } else if (ss->running && (ss->ready || bte_timeout(ss->tree) == 0)) {
+                task_rc = bte_tick(ss->tree, SERVE_TICK_BUDGET);
             }
+            if (task_rc != BTE_RUNNING) {
+                sessionEnd(ss, task_rc);
+            }
+            // session is freed once client got result or is gone
+            if ((sessionFlush(ss) || !ss->out_n) && ss->done) {
+                *pss = ss->next;
+                sessionFree(ss);
+                continue;
+            }
+            pss = &ss->next;
         }
+        task_rc = BTE_SUCCESS;
     }
+    ullog_info("stop serving on %s", path);
 
     bail:
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
+    while ((ss = sessions) != NULL) {
+        sessions = ss->next;
+        if (!ss->done) {
+            sessionEnd(ss, BTE_ERROR);
+        }
+        sessionFree(ss);
+    }
+    if (pfds) free(pfds);
+    if (lfd >= 0) {
+        close(lfd);
+        unlink(path);
+    }
+    bte_cleanup();
 
     ullog_debug("exit");
     return task_rc;
 }
 
-static rc_t 
-processNode(xmlNodePtr node) 
+/**
+ * \brief   run tree file on server and print its output, 
+ *  file '-' sends document from stdin
+ * \return:
+ *  result of tree
+ */
+static bte_rc_t
+submitSocket(const char *path, const char *filename)
 {
     ullog_debug("enter");
 
-    rc_t task_rc = RC_SUCCESS;
-
-    if (xmlStrcmp(node->name, (const xmlChar *) "action") == 0) {
-        ullog_debug("action node address '%p'", node);
-        task_rc = processActionLeaf(node);
-    } else if (xmlStrcmp(node->name, (const xmlChar *) "sequence") == 0) {
-        ullog_debug("sequence node address '%p'", node);
-        task_rc = processSequenceNode(node->children);
-    } else if (xmlStrcmp(node->name, (const xmlChar *) "select") == 0) {
-        ullog_debug("select node address '%p'", node);
-        task_rc = processSelectNode(node->children);
-    } else if (xmlStrcmp(node->name, (const xmlChar *) "decorator") == 0) {
-        ullog_debug("decorator node address '%p'", node);
-        task_rc = processDecoratorNode(node);
-    } else {
-        ullog_err("node '%s' is not supported", node->name);
-        _xmlDump(node, 0);
-        task_rc = RC_ERROR;
+    bte_rc_t task_rc = BTE_ERROR;
+    bte_rc_t rc = BTE_SUCCESS;
+    int fd = -1;
+    struct sockaddr_un addr;
+    char file_path[PATH_MAX] = "";
+    char line[64] = "";
+    char buf[PATH_MAX + 16];
+    size_t len = 0;
+    size_t n = 0;
+    FILE *in = NULL;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        ullog_err("socket path %s is too long", path);
+        goto bail;
+    }
+    strcpy(addr.sun_path, path);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 || 
+            connect(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+        ullog_err("cannot connect to %s: %s", path, strerror(errno));
         goto bail;
     }
 
-    bail:
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-
-    ullog_debug("exit");
-    return task_rc;
-}
-
-static rc_t 
-processRootNode(xmlNodePtr node) 
-{
-    ullog_debug("enter");
-
-    rc_t task_rc = RC_SUCCESS;
-    xmlNodePtr cur_node = NULL;
-
-    for (cur_node = node; cur_node; cur_node = cur_node->next) {
-        if (cur_node->type == XML_ELEMENT_NODE) {
-            if (xmlStrcmp(cur_node->name, (const xmlChar *) "bt") == 0) {
-                ullog_debug("node is bt");
-                task_rc = processSequenceNode(cur_node->children);
-                // only one bt node
-                goto bail;
-            } else {
-                ullog_err("node '%s' is not supported", cur_node->name);
-                _xmlDump(cur_node, 0);
-                task_rc = RC_ERROR;
+    if (strcmp(filename, "-") == 0) {
+        if (_write_all(fd, "xml\n", 4)) {
+            ullog_err("cannot send request: %s", strerror(errno));
+            goto bail;
+        }
+        while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0) {
+            if (_write_all(fd, buf, n)) {
+                ullog_err("cannot send request: %s", strerror(errno));
                 goto bail;
             }
         }
+    } else {
+        if (!realpath(filename, file_path)) {
+            ullog_err("unable to open file %s", filename);
+            goto bail;
+        }
+        snprintf(buf, sizeof(buf), "path %s\n", file_path);
+        if (_write_all(fd, buf, strlen(buf))) {
+            ullog_err("cannot send request: %s", strerror(errno));
+            goto bail;
+        }
     }
+    shutdown(fd, SHUT_WR);
 
-    bail:
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
-
-    ullog_debug("exit");
-    return task_rc;
-}
-
-rc_t 
-processFile(const char *filename) 
-{
-    ullog_debug("enter");
-
-    xmlDocPtr doc = NULL;
-    xmlNodePtr rootNode = NULL;
-    rc_t task_rc = RC_FAILURE;
-    int run_i = 1;
-
-    ullog_debug("start xmlReadFile");
-    doc = xmlReadFile(filename, NULL, 0);
-    if (doc == NULL) {
-        ullog_err("unable to open file %s", filename);
-        task_rc = RC_ERROR;
+    if ((in = fdopen(fd, "r")) == NULL) {
+        ullog_err("cannot read response: %s", strerror(errno));
         goto bail;
     }
-    ullog_debug("done xmlReadFile: doc %p", doc);
-
-    rootNode = xmlDocGetRootElement(doc);
-    if (rootNode == NULL) {
-        ullog_err("unable to open file %s: no root element", filename);
-        task_rc = RC_ERROR;
-        goto bail;
+    fd = -1;
+    while (fgets(line, sizeof(line), in)) {
+        if (sscanf(line, "out %zu", &len) == 1) {
+            while (len && (n = fread(buf, 1, 
+                            len < sizeof(buf) ? len : sizeof(buf), in)) > 0) {
+                fwrite(buf, 1, n, stdout);
+                len -= n;
+            }
+        } else if (strncmp(line, "rc ", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            for (rc = BTE_SUCCESS; rc <= BTE_ERROR; ++rc) {
+                if (strcmp(line + 3, bte_rc_str(rc)) == 0) {
+                    task_rc = rc;
+                }
+            }
+            break;
+        }
     }
-    // process root as sequence
-    // need to keep running if it is still in RUNNING state
-    ullog_debug("start processRootNode");
-    do {
-        ullog_debug("start run iteration %d", run_i);
-        task_rc = processRootNode(rootNode);
-        ullog_debug("done run iteration %d task_rc %s", run_i, rc2rstr(task_rc));
-        ++run_i;
-    } while (task_rc == RC_RUNNING);
-    ullog_debug("done processRootNode rc %s", rc2rstr(task_rc));
+    fflush(stdout);
 
     bail:
-    if (doc) xmlFreeDoc(doc);
-    xmlCleanupParser();
-    ullog_debug("task_rc %s", rc2rstr(task_rc));
+    if (in) fclose(in);
+    if (fd >= 0) close(fd);
 
     ullog_debug("exit");
     return task_rc;
@@ -1424,33 +812,117 @@ main(int argc, char *argv[])
     ullog_init("bte");
     ullog_debug("enter bte");
 
-    rc_t task_rc = RC_FAILURE;
-
-    ullog_debug("enable debug");
-
-    if (argc < 2) {
-        ullog_err("provide file");
-        task_rc = RC_ERROR;
-        goto bail;
-    }
-    if (argc == 3) {
-        if (strncmp(argv[1], "-d", 2) == 0) {
+    int task_rc = BTE_FAILURE;
+    int opt = 0;
+    const char *serve_path = NULL;
+    const char *submit_path = NULL;
+    const char *out_file = NULL;
+    static const struct option long_opts[] = {
+        {"serve", required_argument, NULL, 'L'},
+        {"submit", required_argument, NULL, 'C'},
+        {"resume", no_argument, NULL, 'R'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "dSs:o:t:l:vc:j:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
             ullog_debug("enable debug");
-            g_debug = 1;
+            bte_set_debug(1);
+            break;
+        case 's':
+            g_state_file = optarg;
+            break;
+        case 'S':
+            g_stats = 1;
+            bte_set_stats(1);
+            break;
+        case 'o':
+            out_file = optarg;
+            break;
+        case 't':
+            g_trace_file = optarg;
+            break;
+        case 'l':
+            g_log_file = optarg;
+            break;
+        case 'v':
+            g_log_level = BTE_LOG_DEBUG;
+            break;
+        case 'L':
+            serve_path = optarg;
+            break;
+        case 'C':
+            submit_path = optarg;
+            break;
+        case 'c':
+            g_ckpt_file = optarg;
+            break;
+        case 'R':
+            g_resume = 1;
+            break;
+        case 'j':
+            g_threads = atoi(optarg);
+            break;
+        default:
+            ullog_err("usage: %s [-d] [-S] [-s state.xml] [-t trace.json] [-l log.btel [-v]] "
+                    "[-c run.btec [--resume]] file", argv[0]);
+            ullog_err("       %s [-S] -j threads file...", argv[0]);
+            ullog_err("       %s compile file.xml [-o file.bteb]", argv[0]);
+            ullog_err("       %s [-l log.btel [-v]] --serve socket", argv[0]);
+            ullog_err("       %s --submit socket file", argv[0]);
+            task_rc = BTE_ERROR;
+            goto bail;
         }
     }
+    // SIGUSR1 writes log of running trees
+    if (g_log_file) {
+        bte_set_log_level(g_log_level);
+        signal(SIGUSR1, _dump_signal);
+    }
+    if (g_resume && !g_ckpt_file) {
+        ullog_err("--resume needs checkpoint file given by -c");
+        task_rc = BTE_ERROR;
+        goto bail;
+    }
+    if (serve_path) {
+        ullog_debug("start serveSocket");
+        task_rc = serveSocket(serve_path);
+        goto bail;
+    }
+    if (optind >= argc) {
+        ullog_err("provide file");
+        task_rc = BTE_ERROR;
+        goto bail;
+    }
     ullog_debug("done process cli");
 
-    ullog_debug("start processFile");
-    if (argc == 3) {
-        task_rc = processFile(argv[2]);
-    } else {
-        task_rc = processFile(argv[1]);
+    if (strcmp(argv[optind], "compile") == 0 && optind + 1 < argc) {
+        ullog_debug("start compileFile");
+        task_rc = compileFile(argv[optind + 1], out_file);
+        goto bail;
+    }
+    if (submit_path) {
+        ullog_debug("start submitSocket");
+        task_rc = submitSocket(submit_path, argv[optind]);
+        goto bail;
     }
-    ullog_debug("done processFile rc %s", rc2rstr(task_rc));
+
+    if (g_threads >= 0) {
+        ullog_debug("start processPool");
+        task_rc = processPool(argv + optind, argc - optind, g_threads);
+        goto bail;
+    }
+
+    ullog_debug("start processFile");
+    task_rc = processFile(argv[optind]);
+    ullog_debug("done processFile rc %s", bte_rc_str(task_rc));
 
     bail:
-    ullog_debug("rc %s", rc2rstr(task_rc));
+    if (g_log_file) {
+        bte_save_log(g_log_file);
+    }
+    ullog_debug("rc %s", bte_rc_str(task_rc));
     ullog_deinit();
 
     ullog_debug("exit bte");
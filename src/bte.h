@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2014 - 2020 <aiy@ferens.net> 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * behavior tree engine library
+ *
+ * Tree is loaded and compiled once, then ticked by caller. Tick never 
+ * blocks: running nodes wait for fds and deadlines, which caller adds to 
+ * its own event loop with bte_fd() or bte_pollfds() and bte_timeout().
+ */
+
+#ifndef BTE_H
+#define BTE_H
+
+#include <stddef.h>
+#include <poll.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// result of tree and its nodes
+typedef enum {
+    BTE_SUCCESS, // clean success
+    BTE_FAILURE, // clean failure
+    BTE_RUNNING, // running
+    BTE_ERROR, // unexpected failure
+    BTE_UNKNOWN, // node was not run
+} bte_rc_t;
+
+typedef struct bte_tree bte_tree_t;
+typedef struct bte_pool bte_pool_t;
+
+// level of binary log records, rendered by bte-log
+typedef enum {
+    BTE_LOG_OFF, // nothing is recorded
+    BTE_LOG_INFO, // node results, spawns, stream opens, closes and matches
+    BTE_LOG_DEBUG, // node entries, reads, writes and waits too
+} bte_log_level_t;
+
+// exec output of tree
+typedef void (*bte_output_cb)(void *ctx, const char *buf, size_t len);
+// node finished with rc
+typedef void (*bte_result_cb)(void *ctx, const char *node_id, bte_rc_t rc);
+// tree run by pool finished with rc, called on worker thread
+typedef void (*bte_done_cb)(void *ctx, bte_tree_t *tree, bte_rc_t rc);
+
+/**
+ * \brief   load and compile tree from xml file or buffer, 
+ *  file may be binary image of bte_compile()
+ * \return:
+ *  tree - success
+ *  NULL - error
+ */
+bte_tree_t *bte_load_file(const char *filename);
+bte_tree_t *bte_load_memory(const char *buf, size_t len);
+
+/**
+ * \brief   compile xml tree file into binary image out, 
+ *  bte_load_file() maps image and falls back to its source xml 
+ *  when source has changed since
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_compile(const char *filename, const char *out);
+
+/**
+ * \brief   stop running commands and streams of tree and free it
+ */
+void bte_free(bte_tree_t *tree);
+
+/**
+ * \brief   set where exec output goes, stdout is used if cb is NULL
+ */
+void bte_set_output(bte_tree_t *tree, bte_output_cb cb, void *ctx);
+
+/**
+ * \brief   set callback called when node finishes
+ */
+void bte_set_result(bte_tree_t *tree, bte_result_cb cb, void *ctx);
+
+/**
+ * \brief   tick tree at most budget times while some node is ready
+ * \return:
+ *  BTE_RUNNING - wait for bte_fd(), bte_pollfds() or bte_timeout() 
+ *  and tick again
+ *  other - result of tree
+ */
+bte_rc_t bte_tick(bte_tree_t *tree, unsigned int budget);
+
+/**
+ * \brief   tick tree until it finishes, waiting in between
+ * \return:
+ *  result of tree
+ */
+bte_rc_t bte_run(bte_tree_t *tree);
+
+/**
+ * \brief   wait at most timeout ms, -1 for ever, until some running 
+ *  node of tree can make progress
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_wait(bte_tree_t *tree, long long timeout);
+
+/**
+ * \brief   stop running nodes of tree
+ */
+void bte_halt(bte_tree_t *tree);
+
+/**
+ * \brief   start pool of threads running many trees at once, 0 threads 
+ *  means one per online cpu, each worker ticks trees from its own run 
+ *  queue and steals from other workers when it runs out, trees waiting 
+ *  for fds and timers are parked outside of all queues
+ * \return:
+ *  pool - success
+ *  NULL - error, not supported on this system
+ */
+bte_pool_t *bte_pool_new(unsigned int threads);
+
+/**
+ * \brief   run tree on pool, tree belongs to worker ticking it until 
+ *  cb is called and must not be used by caller until then
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_pool_submit(bte_pool_t *pool, bte_tree_t *tree, bte_done_cb cb, void *ctx);
+
+/**
+ * \brief   wait until all trees submitted to pool finished
+ */
+void bte_pool_wait(bte_pool_t *pool);
+
+/**
+ * \brief   wait for submitted trees and stop threads of pool
+ */
+void bte_pool_free(bte_pool_t *pool);
+
+/**
+ * \brief   pollable fd becoming readable when some node is ready
+ * \return:
+ *  fd - epoll fd of tree
+ *  -1 - not supported on this system, use bte_pollfds()
+ */
+int bte_fd(bte_tree_t *tree);
+
+/**
+ * \brief   fill at most n poll fds that running nodes wait for
+ * \return:
+ *  total number of fds that nodes wait for
+ */
+unsigned int bte_pollfds(bte_tree_t *tree, struct pollfd *pfds, unsigned int n);
+
+/**
+ * \brief   time until tree must be ticked without fd readiness
+ * \return:
+ *  N - milliseconds
+ *  -1 - only fds are waited for
+ */
+long long bte_timeout(bte_tree_t *tree);
+
+/**
+ * \brief   write source xml of tree with _state_ attribute of each node, 
+ *  source is read again since tree does not keep document, 
+ *  trees loaded from memory have no source
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_save_state(bte_tree_t *tree, const char *filename);
+
+/**
+ * \brief   print run statistics of tree to stderr, 
+ *  timings are collected after bte_set_stats(1)
+ */
+void bte_print_stats(bte_tree_t *tree, long long run_ns);
+
+/**
+ * \brief   append succeeded nodes and captured variables of tree to 
+ *  checkpoint file, records are written each tick, synced to disk 
+ *  within a second or after 64 records and when tree finishes, 
+ *  checkpoint which cannot be written or synced is dropped, 
+ *  with resume nodes succeeded in checkpoint do not 
+ *  run again and variables get their values back, 
+ *  checkpoint is rewritten compact when it is started
+ * \return:
+ *  0 - success
+ *  -1 - error, checkpoint belongs to other tree
+ */
+int bte_set_checkpoint(bte_tree_t *tree, const char *filename, int resume);
+
+/**
+ * \brief   record node runs, state changes, spawns, matches and waits 
+ *  of tree into ring of last events, 0 events stops tracing
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_set_trace(bte_tree_t *tree, size_t events);
+
+/**
+ * \brief   write recorded events of tree as chrome trace event json
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_save_trace(bte_tree_t *tree, const char *filename);
+
+/**
+ * \brief   record binary log of all trees at level and below, each thread 
+ *  into its own ring of last records, BTE_LOG_OFF stops logging
+ */
+void bte_set_log_level(bte_log_level_t level);
+
+/**
+ * \brief   write log records of all threads for bte-log
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+int bte_save_log(const char *filename);
+
+void bte_set_debug(int enable);
+void bte_set_stats(int enable);
+const char *bte_rc_str(bte_rc_t rc);
+long long bte_now_ns(void);
+
+/**
+ * \brief   free parser globals at exit
+ */
+void bte_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BTE_H
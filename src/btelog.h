@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2014 - 2020 <aiy@ferens.net> 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+ * binary log records of libbte, shared by engine and bte-log decoder
+ *
+ * Engine appends fixed size records of format id and integer args to ring 
+ * of logging thread, bte-log renders them with format table below. Node 
+ * is index of node in compiled tree, which is also id of nodes without id.
+ */
+
+#ifndef _BTELOG_H_
+#define _BTELOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BTELOG_MAGIC "BTEL"
+#define BTELOG_VERSION 1
+#define BTELOG_NO_NODE 0xffffffffU // record is not about a node
+#define BTELOG_ARGS 3
+
+// format id, level and text of records, %d is integer arg and %r is rc
+#define BTELOG_FORMATS(X) \
+    X(LOG_TICK, BTE_LOG_DEBUG, "tick budget %d") \
+    X(LOG_TICK_RC, BTE_LOG_DEBUG, "tick rc %r") \
+    X(LOG_NODE_ENTER, BTE_LOG_DEBUG, "enter state %r") \
+    X(LOG_NODE_EXIT, BTE_LOG_DEBUG, "exit rc %r") \
+    X(LOG_NODE_STATE, BTE_LOG_INFO, "state %r from %r") \
+    X(LOG_NODE_HALT, BTE_LOG_INFO, "halt") \
+    X(LOG_IO_TAKEOVER, BTE_LOG_DEBUG, "takes fd %d over from node %d") \
+    X(LOG_WAIT, BTE_LOG_DEBUG, "wait for %d fds %d timers timeout %d ms") \
+    X(LOG_WAIT_NONE, BTE_LOG_DEBUG, "nothing to wait for") \
+    X(LOG_WRITE_ERR, BTE_LOG_INFO, "write %d of %d bytes errno %d") \
+    X(LOG_SPAWN, BTE_LOG_INFO, "spawned pid %d fd %d") \
+    X(LOG_REAP, BTE_LOG_INFO, "reaped pid %d status %d") \
+    X(LOG_EXEC_READ, BTE_LOG_DEBUG, "read %d bytes of output") \
+    X(LOG_EXEC_EOF, BTE_LOG_INFO, "output eof fd %d") \
+    X(LOG_STREAM, BTE_LOG_DEBUG, "stream slot %d fd %d buffered %d") \
+    X(LOG_STREAM_OPEN, BTE_LOG_INFO, "opened stream slot %d fd %d pid %d") \
+    X(LOG_STREAM_CLOSE, BTE_LOG_INFO, "closed stream slot %d fd %d") \
+    X(LOG_STREAM_NONE, BTE_LOG_INFO, "stream slot %d is not open") \
+    X(LOG_EXPECT_MATCH, BTE_LOG_INFO, "matched %d bytes") \
+    X(LOG_EXPECT_WAIT, BTE_LOG_DEBUG, "no match in %d bytes, keep running") \
+    X(LOG_EXPECT_EOF, BTE_LOG_INFO, "no match in %d bytes before stream end") \
+    X(LOG_WRITE, BTE_LOG_DEBUG, "written %d of %d bytes") \
+    X(LOG_TMPL, BTE_LOG_DEBUG, "template expanded to %d bytes") \
+    X(LOG_VAR_UNSET, BTE_LOG_INFO, "variable %d is not set") \
+    X(LOG_SETTLE, BTE_LOG_DEBUG, "pending bytes %d seen %d") \
+    X(LOG_PARALLEL, BTE_LOG_DEBUG, "succeeded %d failed %d running %d") \
+    X(LOG_NODE_TIMEOUT, BTE_LOG_INFO, "timed out after %d ms") \
+    X(LOG_NODE_AGAIN, BTE_LOG_INFO, "run %d ended %r, run again") \
+    X(LOG_EXEC_CACHED, BTE_LOG_INFO, "reused cached result %r with %d bytes of output") \
+    X(LOG_CKPT_RESTORE, BTE_LOG_INFO, "restored %d succeeded nodes %d variables")
+
+#define BTELOG_ENUM(id, level, text) id,
+typedef enum {
+    BTELOG_FORMATS(BTELOG_ENUM)
+    LOG_FORMATS_N
+} btelog_fmt_t;
+#undef BTELOG_ENUM
+
+// one record, written by logging thread only
+typedef struct {
+    long long ts; // monotonic ns
+    unsigned short fmt; // btelog_fmt_t
+    unsigned short thread; // ordinal of logging thread
+    unsigned int node; // node index or BTELOG_NO_NODE
+    long long args[BTELOG_ARGS];
+} btelog_rec_t;
+
+// log file starts with header followed by records of each thread
+typedef struct {
+    char magic[4]; // BTELOG_MAGIC
+    unsigned int version; // BTELOG_VERSION
+    unsigned int rec_size; // sizeof(btelog_rec_t)
+    unsigned int formats_n; // LOG_FORMATS_N of writer
+    unsigned long long recs_n;
+} btelog_header_t;
+
+#ifdef __cplusplus
+}  
+#endif //#ifdef __cplusplus
+
+#endif /* _BTELOG_H_ */
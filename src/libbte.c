@@ -0,0 +1,6241 @@
+/*
+ * Copyright (c) 2014 - 2020 <aiy@ferens.net> 
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/*
+http://en.wikipedia.org/wiki/Behavior_Trees_(Artificial_Intelligence,_Robotics_and_Control)
+*/
+
+#define _GNU_SOURCE // for memmem
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h> // for isspace
+#include <unistd.h> // for dup
+#include <time.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/ioctl.h> // for FIONREAD
+#include <sys/wait.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include <libxml/xmlreader.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include <libxml/debugXML.h>
+
+#include <expect.h>
+
+#include "uthash.h"
+#include "bte.h"
+#include "btelog.h"
+
+#define ULLOG_DEST (ULLOG_DEST_STDOUT)
+//#define ULLOG_DEST (ULLOG_DEST_STDOUT | ULLOG_DEST_STDERR)
+//#define ULLOG_DEST (ULLOG_DEST_STDOUT | ULLOG_DEST_STDERR | ULLOG_DEST_SYSLOG)
+#define ULLOG_LEVEL ULLOG_NOTICE
+//#define ULLOG_LEVEL ULLOG_DEBUG
+#include "ullog.h"
+
+// VERSION 0.0.1
+static int g_debug = 0;
+static int g_expect_debug = 0;
+static int g_stats = 0; // print run statistics to stderr
+#define REACTOR_MAX_EVENTS 64
+#define POOL_TICK_BUDGET 16 // ticks of one tree before worker takes next one
+#define POOL_MAX_EVENTS 64
+#define SETTLE_MS_DEFAULT 1000
+#define EXEC_SHELL "/bin/sh"
+#define EXEC_READ_SIZE 65536 // free space kept for one read of exec output
+#define EXEC_DRAIN_MAX (1024 * 1024) // exec output drained per tick
+#define EXEC_CACHE_MAX (16 * 1024 * 1024) // bytes kept by exec cache of process
+#define EXEC_CACHE_ENTRY_MAX (EXEC_CACHE_MAX / 4) // output of one cached exec
+#define EXEC_SHELL_CHARS "|&;<>()$`\\\"'*?[]#~=%{}!\n"
+#define LOOP_BACKOFF_SHIFT_MAX 16 // backoff of retry and repeat doubles up to 65536 times
+#define STREAM_REAP_MS 1000 // hung up stream process gets SIGTERM and then SIGKILL after
+
+extern char **environ;
+
+// compiled node kinds
+typedef enum {
+    NODE_ROOT,
+    NODE_SEQUENCE,
+    NODE_SELECT,
+    NODE_PARALLEL,
+    NODE_DECORATOR_SUCCEEDER,
+    NODE_ACTION,
+    NODE_SUBTREE, // use of shared fragment, its only child is fragment root
+    NODE_DECORATOR_TIMEOUT, // child fails when running longer than timeout_ms
+    NODE_DECORATOR_RETRY, // child runs again after failure, count times at most
+    NODE_DECORATOR_REPEAT, // child runs again after success, count times
+} node_kind_t;
+
+// compiled action kinds
+typedef enum {
+    ACTION_NONE, // action without body
+    ACTION_EXEC,
+    ACTION_OPEN,
+    ACTION_CLOSE,
+    ACTION_EXPECT,
+    ACTION_WRITE,
+    ACTION_MATCH, // pattern over blackboard variable
+} action_kind_t;
+
+// how open and write actions wait for peer before they succeed
+typedef enum {
+    SETTLE_DELAY, // wait settle_ms, default
+    SETTLE_NONE, // succeed at once
+    SETTLE_OUTPUT, // wait for first output byte, at most settle_ms
+    SETTLE_QUIET, // wait until no output comes for settle_ms
+    SETTLE_WRITABLE, // wait until stream is writable, at most settle_ms
+} settle_kind_t;
+
+typedef struct {
+    const int code;
+    const char *str;
+} settles_t;
+
+const settles_t settles_str_mapping[] = {
+    {SETTLE_DELAY, "delay"},
+    {SETTLE_NONE, "none"},
+    {SETTLE_OUTPUT, "output"},
+    {SETTLE_QUIET, "quiet"},
+    {SETTLE_WRITABLE, "writable"},
+    {SETTLE_DELAY, NULL},
+};
+
+enum os_type {
+    UNIX,
+};
+typedef enum os_type os_t;
+
+// return code, values match bte_rc_t of library api
+typedef enum {
+    RC_SUCCESS, // clean success
+    RC_FAILURE, // clean failure
+    RC_RUNNING, // running
+    RC_ERROR, // unexpected failure
+    RC_UNKNOWN, // unknown code
+} rc_t;
+
+typedef struct {
+    const int code;
+    const char *str;
+} rcs_t;
+
+const rcs_t rcs_str_mapping[] = {
+    {RC_SUCCESS, "success"},
+    {RC_FAILURE, "failure"},
+    {RC_RUNNING, "running"},
+    {RC_ERROR, "error"},
+    {RC_UNKNOWN, NULL},
+};
+
+struct action_node {
+    char *value;
+    int type;
+    int os;
+};
+
+// progress of expect pattern over growing buffer
+typedef struct {
+    size_t scanned; // bytes of buffer seen by match states
+    unsigned long long *nfa; // glob states active after scanned bytes
+    size_t nfa_words;
+    int dropped; // output before buffer was dropped unmatched, ^ cannot match
+} match_state_t;
+
+#define STREAM_BUF_SIZE 2048
+typedef struct fp_table {
+    const char * id; // stream id
+    FILE * fp; 
+    int fd;
+    pid_t pid; // process behind stream
+    char read_buf[STREAM_BUF_SIZE]; // stream output not consumed by expect
+    size_t read_bytes;
+    int match_node; // expect node owning match state, -1 if none
+    match_state_t ms; // match state of read_buf
+} fp_table_t;
+
+// process of closed stream which did not exit yet
+typedef struct {
+    pid_t pid;
+    int sig; // sent at deadline
+    long long deadline; // monotonic ms
+} reap_t;
+
+// blackboard value kinds
+typedef enum {
+    VAR_UNSET, // never captured
+    VAR_TEXT, // bytes captured from exec or stream output
+} var_kind_t;
+
+// blackboard variable, keys are resolved to slots at load, 
+// value buffer is kept and refilled by each capture
+typedef struct {
+    unsigned short kind; // var_kind_t
+    char *buf;
+    size_t len;
+    size_t size;
+    match_state_t ms; // match state of match nodes over value
+} bb_var_t;
+
+// part of write template, literal text followed by variable value, 
+// subtree params are parts assigning literal to variable
+typedef struct {
+    unsigned int lit; // literal in tree string pool
+    unsigned int lit_len;
+    unsigned int var; // variable slot, 0 if part has no variable
+} tmpl_part_t;
+
+// compiled expect pattern kinds
+typedef enum {
+    MATCH_LITERAL, // substring search
+    MATCH_GLOB, // glob states stepped per byte
+} match_kind_t;
+
+#define MATCH_ANCHOR_START (1 << 0) // pattern starts with ^
+#define MATCH_ANCHOR_END (1 << 1) // pattern ends with $
+#define MATCH_CONSUME_ALL (1 << 2) // pattern ends with *, match eats buffer
+
+// glob token kinds
+typedef enum {
+    GLOB_CHAR,
+    GLOB_ANY, // ?
+    GLOB_STAR, // *
+    GLOB_CLASS, // [...]
+} glob_kind_t;
+
+typedef struct {
+    unsigned char kind; // glob_kind_t
+    unsigned char c;
+    unsigned char set[32]; // bitmap of class chars
+} glob_tok_t;
+
+// compiled expect pattern
+typedef struct {
+    unsigned short kind; // match_kind_t
+    unsigned short flags;
+    unsigned int lit; // literal in tree string pool
+    unsigned int lit_len;
+    unsigned int toks; // first token in tree tokens table
+    unsigned int toks_n;
+} matcher_t;
+
+// compiled tree node
+// all strings are offsets into tree string pool, 0 is empty string
+typedef struct {
+    unsigned short kind; // node_kind_t
+    unsigned short action; // action_kind_t
+    unsigned int child_first; // index of first child in tree kids table
+    unsigned int child_count;
+    unsigned int id;
+    unsigned int stream_id;
+    unsigned int stream; // slot of stream_id in tree streams table, 0 if none
+    unsigned int var; // blackboard slot of data attribute, 0 if none
+    unsigned int tmpl; // first part of write template in tree parts table
+    unsigned int tmpl_n; // parts of write template or subtree params, 
+                         // 0 if none
+    unsigned int frame_n; // variables each use of subtree has own slots for, 
+                          // params and then captures of fragment, in parts at tmpl
+    unsigned int value; // action payload
+    unsigned int value_len;
+    unsigned int line; // source line
+    unsigned short settle; // settle_kind_t of open and write
+    unsigned int settle_ms;
+    unsigned short shell; // exec command needs shell
+    unsigned int matcher; // index of expect pattern in tree matchers
+    unsigned int success_threshold; // succeeded children resolving parallel
+    unsigned int failure_threshold; // failed children resolving parallel
+    unsigned int timeout_ms; // running node is halted and fails after, 0 if never
+    unsigned int count; // runs of retry and repeat decorator, 0 if unbounded
+    unsigned int backoff_ms; // wait of retry and repeat decorator before next run
+    unsigned int cache_ttl_ms; // exec result is reused for, 0 if not cached
+} bt_node_t;
+
+// timers of node, id of timer is node index * TIMER_KINDS + kind
+typedef enum {
+    TIMER_WAIT, // deadline node waits for
+    TIMER_TIMEOUT, // timeout_ms of running node
+    TIMER_KINDS,
+} timer_kind_t;
+
+#define TIMER_ID(idx, kind) ((idx) * TIMER_KINDS + (kind))
+
+// node timer linked into slot of timer wheel
+typedef struct {
+    long long expires; // monotonic ms
+    unsigned int slot; // wheel slot + 1, 0 if timer is not armed
+    unsigned int next; // timer id + 1 of next timer in slot, 0 if none
+    unsigned int prev; // timer id + 1 of previous timer in slot, 0 if none
+} wheel_timer_t;
+
+// node runtime state
+typedef struct {
+    rc_t rc; // last result, RC_UNKNOWN if node was not run
+    pid_t pid; // exec process, 0 if none
+    int out_fd; // exec stdout and stderr, -1 if none
+    size_t written_bytes; // write cursor
+    unsigned int cursor; // running child of composite node, 
+                         // finished runs of retry and repeat decorator
+    int io_fd; // fd node waits for, -1 if none
+    long long deadline; // monotonic ms node waits for, 0 if none
+    int ready; // io_fd became ready or deadline passed
+    int settling; // action is done and waits for peer to settle
+    int settle_bytes; // pending stream bytes seen while settling
+    char *tmpl_buf; // write template expanded when write starts
+    size_t tmpl_len;
+    size_t tmpl_size;
+    char *cache_buf; // output of cached exec collected until it ends
+    size_t cache_len;
+    size_t cache_size;
+    int cache_skip; // output outgrew EXEC_CACHE_ENTRY_MAX, result is not kept
+    wheel_timer_t timers[TIMER_KINDS];
+    int timed_out; // timeout timer fired while node was running
+    int restored; // success restored from checkpoint, node does not run
+    unsigned int use; // subtree node whose fragment node is in, 0 if none
+    unsigned int frame; // first variable slot of subtree node use
+} bt_state_t;
+
+// readiness events
+#define IO_READ (1 << 0)
+#define IO_WRITE (1 << 1)
+
+// node waiting for fd readiness
+typedef struct {
+    int fd;
+    int events;
+    unsigned int idx; // waiting node
+} io_wait_t;
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS) // slots of one level
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4 // slot of level l spans 64^l ms
+#define WHEEL_SPAN (1LL << (WHEEL_BITS * WHEEL_LEVELS)) // 4.6 hours
+
+// hierarchical timer wheel, timers cascade to lower levels as time passes
+typedef struct {
+    long long now; // first ms whose timers have not expired yet
+    unsigned int heads[WHEEL_LEVELS * WHEEL_SLOTS]; // timer id + 1 of first timer
+    unsigned long long used[WHEEL_LEVELS]; // bitmap of slots with timers
+    unsigned int armed_n;
+} timer_wheel_t;
+
+// readiness reactor of running nodes
+typedef struct {
+    int epfd; // epoll instance, -1 if poll is used
+    io_wait_t *waits;
+    unsigned int waits_n;
+    size_t waits_size;
+    timer_wheel_t wheel; // deadlines and timeouts of nodes
+    int busy; // node is running without waiting, tick again at once
+} reactor_t;
+
+// run statistics, timings are collected only with -S
+typedef struct {
+    unsigned long ticks;
+    long long tick_ns;
+    unsigned long dispatches; // nodes processed in all ticks
+    unsigned long spawns;
+    long long spawn_ns;
+    unsigned long cache_hits; // exec results reused from cache
+    unsigned long long expect_bytes; // bytes scanned by expect patterns
+    long long expect_ns;
+    unsigned long long write_bytes;
+    long long write_ns;
+} bt_stats_t;
+
+// trace event kinds
+typedef enum {
+    TRACE_NODE, // node was processed
+    TRACE_STATE, // node state changed
+    TRACE_SPAWN, // exec or open started process
+    TRACE_MATCH, // expect or match scanned buffer
+    TRACE_WAIT, // tree waited for fds and timers
+} trace_what_t;
+
+const char *trace_what_str[] = {"node", "state", "spawn", "match", "wait"};
+
+const char *node_kind_str[] = {"root", "sequence", "select", "parallel", 
+    "decorator", "action", "subtree", "timeout", "retry", "repeat"};
+
+const char *action_kind_str[] = {"none", "exec", "open", "close", "expect", 
+    "write", "match"};
+
+// entry of trace ring, spans have duration, state changes have none
+typedef struct {
+    long long ts; // monotonic ns
+    long long dur;
+    unsigned int node; // node index
+    unsigned char what; // trace_what_t
+    unsigned char rc; // rc_t after event
+    unsigned char prev_rc; // rc_t before state change
+} trace_event_t;
+
+// bump allocator, memory is released all at once
+#define ARENA_BLOCK_SIZE 16384
+#define ARENA_ALIGN 16
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size; // bytes of data
+    size_t used;
+    char data[];
+} arena_block_t;
+
+typedef struct {
+    arena_block_t *head;
+    arena_block_t *cur; // block being filled, blocks after it are empty
+    size_t bytes; // bytes of all blocks
+} arena_t;
+
+// interned string
+typedef struct {
+    char *key;
+    unsigned int off;
+    unsigned int slot; // stream slot if string is a stream id, 0 if not
+    unsigned int var; // blackboard slot if string is a variable name, 0 if not
+    UT_hash_handle hh;
+} intern_t;
+
+// exec result kept for cache_ttl_ms, shared by all trees of process, 
+// hash keeps entries from least to most recently used
+typedef struct {
+    char *key; // environment hash followed by command
+    long long expires; // monotonic ms
+    rc_t rc;
+    char *out;
+    size_t out_len;
+    size_t out_size;
+    UT_hash_handle hh;
+} exec_cache_t;
+
+static exec_cache_t *g_exec_cache = NULL;
+static size_t g_exec_cache_bytes = 0; // keys and outputs of entries
+static pthread_mutex_t g_exec_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_expect_lock = PTHREAD_MUTEX_INITIALIZER; // libexpect globals
+
+// fragment compiled for subtree ref
+typedef struct {
+    char *key; // resolved path and fragment id
+    unsigned int root; // node index of compiled fragment
+    unsigned int *locals; // variable slots captured by fragment
+    unsigned int locals_n;
+    int busy; // fragment is being compiled, ref to it is a cycle
+    UT_hash_handle hh;
+} subtree_t;
+
+// file read by compile, xml of tree and files of its subtrees, 
+// stored in binary image
+typedef struct {
+    long long mtime; // when image was written
+    long long size;
+    unsigned int path; // in string pool
+    unsigned int pad;
+} bteb_src_t;
+
+// compiled tree
+// nodes are stored in document order, node 0 is root
+typedef struct bte_tree {
+    bt_node_t *nodes; // definitions, all uses of subtree share one
+    unsigned int nodes_n;
+    size_t nodes_size;
+    unsigned int *defs; // definition of each node, state is indexed by node
+    unsigned int defs_n; // nodes of tree
+    size_t defs_size;
+    unsigned int *kids;
+    unsigned int kids_n;
+    size_t kids_size;
+    char *strs; // string pool
+    size_t strs_n;
+    size_t strs_size;
+    matcher_t *matchers; // compiled expect patterns
+    unsigned int matchers_n;
+    size_t matchers_size;
+    glob_tok_t *toks; // glob tokens of expect patterns
+    unsigned int toks_n;
+    size_t toks_size;
+    tmpl_part_t *parts; // parts of write templates
+    unsigned int parts_n;
+    size_t parts_size;
+    bt_state_t *state; // runtime state of each node
+    reactor_t reactor;
+    char *out_buf; // exec output drained in current tick
+    size_t out_size;
+    fp_table_t *streams; // indexed by node stream slot, open if fd > 0
+    unsigned int streams_n; // slots in use, slot 0 is never used
+    reap_t *reaps; // processes of closed streams, reaped by ticks
+    unsigned int reaps_n;
+    size_t reaps_size;
+    bb_var_t *vars; // blackboard indexed by node var slot, slot 0 is never used
+    unsigned int vars_n;
+    unsigned int frames_n; // slots of subtree uses after vars_n
+    arena_t arena; // tree lifetime data
+    arena_t scratch; // transient data, reset each tick
+    bte_output_cb output_cb; // exec output goes here, stdout if not set
+    void *output_ctx;
+    bte_result_cb result_cb; // called when node finishes
+    void *result_ctx;
+    unsigned int src; // source xml path in string pool, 0 if loaded from memory
+    bteb_src_t *srcs; // files read by compile, written to image
+    unsigned int srcs_n;
+    size_t srcs_size;
+    void *map; // binary image, tables point into it
+    size_t map_size;
+    bt_stats_t stats;
+    trace_event_t *trace; // ring of last trace events, NULL if not tracing
+    size_t trace_size;
+    unsigned long long trace_n; // events recorded, oldest are overwritten
+    intern_t *intern; // compile time only
+    subtree_t *subtrees; // compile time only
+    const char *compile_src; // path of document being compiled, NULL if memory
+    unsigned int compile_depth; // subtree nesting being compiled
+    unsigned int *locals; // variables captured by fragment being compiled
+    unsigned int locals_n;
+    size_t locals_size;
+    FILE *ckpt; // checkpoint records are appended to, NULL if none
+    long long ckpt_sync; // monotonic ms of last checkpoint fsync
+    unsigned int ckpt_unsynced; // records appended since last fsync
+} bt_tree_t;
+
+// checkpoint written by bte_set_checkpoint(), header is followed by 
+// records appended as nodes succeed and variables are captured, 
+// records after torn or corrupted one are dropped on resume
+#define BTEC_MAGIC "BTEC"
+#define BTEC_VERSION 1
+#define CKPT_SYNC_MS 1000 // appended records are synced within
+#define CKPT_SYNC_RECORDS 64 // or once that many are appended
+
+typedef struct {
+    char magic[4];
+    unsigned int version;
+    unsigned long long tree_hash; // nodes and strings of tree checkpoint belongs to
+    unsigned int nodes_n;
+    unsigned int vars_n;
+} btec_header_t;
+
+// checkpoint record kinds
+typedef enum {
+    CKPT_NODE, // node succeeded
+    CKPT_VAR, // variable was captured, value follows record
+} ckpt_kind_t;
+
+typedef struct {
+    unsigned int kind; // ckpt_kind_t
+    unsigned int slot; // node index or variable slot
+    unsigned int len; // bytes of value following record
+    unsigned int sum; // FNV-1a of record with sum 0 and value
+} btec_rec_t;
+
+// tree run by pool, owned by worker which claimed it, 
+// items are reused and never freed before pool, so late epoll events 
+// of finished tree only find item which is not parked
+typedef struct pool_item {
+    bt_tree_t *tree;
+    bte_done_cb cb;
+    void *ctx;
+    unsigned int parked; // park generation, odd while tree waits for fd or deadline
+    int pending; // fd or deadline came while tree was not parked yet
+    long long deadline; // monotonic ms tree must be ticked by, while in heap
+    unsigned int heap_pos; // index + 1 in deadline heap, 0 if not there
+    int registered; // tree fd is in pool epoll
+    struct pool_item *next; // free items of pool
+} pool_item_t;
+
+// run queue of worker, owner pushes and pops at bottom, 
+// thieves and yielding trees use top
+typedef struct {
+    pthread_mutex_t lock;
+    pool_item_t **items; // ring
+    size_t size; // power of 2
+    size_t top;
+    size_t bottom;
+} run_queue_t;
+
+typedef struct {
+    struct bte_pool *pool;
+    unsigned int id;
+    pthread_t thread;
+    run_queue_t rq;
+    unsigned int steal; // next victim
+} pool_worker_t;
+
+// fixed pool of workers ticking many trees, parked trees wait in one 
+// epoll and in one heap of deadlines, idle workers sleep in that epoll
+typedef struct bte_pool {
+    pool_worker_t *workers;
+    unsigned int workers_n;
+    unsigned int started; // threads to join, workers_n is set before start
+    int epfd;
+    int wakefd; // eventfd waking idle workers, level triggered
+    pthread_mutex_t lock; // deadline heap and active count
+    pthread_cond_t done; // active count dropped to 0
+    pool_item_t **heap;
+    unsigned int heap_n;
+    size_t heap_size;
+    pool_item_t *free_items;
+    unsigned int active; // trees submitted and not finished
+    unsigned int next; // worker of next submitted tree
+    int idle; // workers sleeping in epoll, read without lock
+    int stop;
+} bte_pool_t;
+
+// binary image of compiled tree written by bte_compile(), 
+// tables are stored as in memory and used in place after mmap
+#define BTEB_MAGIC "BTEB"
+#define BTEB_VERSION 9
+#define BTEB_ENDIAN 0x01020304
+#define BTEB_ALIGN 8
+
+typedef struct {
+    char magic[4];
+    unsigned int version;
+    unsigned int endian; // BTEB_ENDIAN in byte order of writer
+    unsigned short header_size; // table layout of writer
+    unsigned short node_size;
+    unsigned short matcher_size;
+    unsigned short tok_size;
+    unsigned short part_size;
+    unsigned short src_size;
+    unsigned int src_path; // source xml path in string pool
+    unsigned int srcs_n;
+    unsigned int nodes_n;
+    unsigned int defs_n;
+    unsigned int kids_n;
+    unsigned int matchers_n;
+    unsigned int toks_n;
+    unsigned int streams_n;
+    unsigned int vars_n;
+    unsigned int parts_n;
+    unsigned long long strs_n;
+    unsigned long long nodes_off;
+    unsigned long long defs_off;
+    unsigned long long kids_off;
+    unsigned long long matchers_off;
+    unsigned long long toks_off;
+    unsigned long long parts_off;
+    unsigned long long strs_off;
+    unsigned long long srcs_off;
+} bteb_header_t;
+
+#define NODE_STR(tree, off) ((const char *) ((tree)->strs + (off)))
+// definition of node idx, nodes of all uses of subtree share definitions
+#define NODE(tree, idx) (&(tree)->nodes[(tree)->defs[idx]])
+// child i of node idx defined by n, kids are offsets from their parent
+#define KID(tree, idx, n, i) ((idx) + (tree)->kids[(n)->child_first + (i)])
+
+static rc_t processRootNode(bt_tree_t *tree);
+static rc_t processNode(bt_tree_t *tree, unsigned int idx);
+static rc_t processDecoratorSucceederNode(bt_tree_t *tree, unsigned int idx);
+static rc_t processDecoratorLoopNode(bt_tree_t *tree, unsigned int idx, rc_t again_rc);
+static rc_t processSubtreeNode(bt_tree_t *tree, unsigned int idx);
+static rc_t processSequenceNode(bt_tree_t *tree, unsigned int idx);
+static rc_t processSelectNode(bt_tree_t *tree, unsigned int idx);
+static rc_t processParallelNode(bt_tree_t *tree, unsigned int idx);
+static void nodeHalt(bt_tree_t *tree, unsigned int idx);
+static void nodeReset(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionLeaf(bt_tree_t *tree, unsigned int idx);
+
+// system specific
+static rc_t processActionExec(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionOpen(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionClose(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionExpect(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionWrite(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionSettle(bt_tree_t *tree, unsigned int idx);
+static rc_t processActionMatch(bt_tree_t *tree, unsigned int idx);
+
+// tree compiler
+static int compileTree(bt_tree_t *tree, xmlTextReaderPtr reader, const char *name, 
+        const char *src);
+static int compileNode(bt_tree_t *tree, xmlTextReaderPtr reader, unsigned int *idx);
+static int compileAction(bt_tree_t *tree, unsigned int idx, xmlTextReaderPtr reader);
+static int compileSubtree(bt_tree_t *tree, unsigned int idx, xmlTextReaderPtr reader);
+static int treeSaveState(bt_tree_t *tree, const char *filename);
+static int treeCheckpoint(bt_tree_t *tree, const char *filename, int resume);
+static void treeCheckpointSync(bt_tree_t *tree, int force);
+static void treeFree(bt_tree_t *tree);
+static void treeStats(bt_tree_t *tree, long long run_ns);
+static rc_t treeTick(bt_tree_t *tree);
+static int treeOutput(bt_tree_t *tree, const char *buf, size_t len);
+static long long _now_ns(void);
+static void _timer_cancel(bt_tree_t *tree, unsigned int id);
+static int _ckpt_add(bt_tree_t *tree, ckpt_kind_t kind, unsigned int slot, 
+        const char *buf, size_t len);
+static unsigned int _var_resolve(const bt_tree_t *tree, unsigned int idx, 
+        unsigned int slot);
+
+
+/**
+ * \brief   record event in trace ring, oldest event is overwritten
+ */
+static void
+_trace_add(bt_tree_t *tree, trace_what_t what, unsigned int idx, long long ts, 
+        long long dur, rc_t rc, rc_t prev_rc)
+{
+    trace_event_t *ev = &tree->trace[tree->trace_n++ % tree->trace_size];
+
+    ev->ts = ts;
+    ev->dur = dur;
+    ev->node = idx;
+    ev->what = what;
+    ev->rc = rc;
+    ev->prev_rc = prev_rc;
+}
+
+/**
+ * \brief   record span of what on node started at t0 and ending now
+ */
+static void
+_trace_span(bt_tree_t *tree, trace_what_t what, unsigned int idx, long long t0, 
+        rc_t rc)
+{
+    _trace_add(tree, what, idx, t0, _now_ns() - t0, rc, rc);
+}
+
+#define LOG_RING_SIZE 8192 // records kept per thread, power of two
+
+// last log records of one thread
+typedef struct log_ring {
+    btelog_rec_t recs[LOG_RING_SIZE];
+    unsigned long long head; // records ever added, stored by owner only
+    unsigned int thread; // ordinal of owner
+    struct log_ring *next; // ring of thread that logged before
+} log_ring_t;
+
+#define BTELOG_LEVEL(id, level, text) level,
+static const int log_fmt_level[] = { BTELOG_FORMATS(BTELOG_LEVEL) };
+#undef BTELOG_LEVEL
+
+static int g_log_level = BTE_LOG_OFF;
+static log_ring_t *g_log_rings = NULL; // pushed lock free by first record of thread
+static unsigned int g_log_threads = 0;
+static __thread log_ring_t *t_log_ring = NULL;
+
+static void _log_add(btelog_fmt_t fmt, unsigned int node, long long a, 
+        long long b, long long c);
+
+// record fmt about node when log level allows it, costs one load otherwise
+#define btlog(fmt, node, a, b, c) \
+    do { \
+        if (__builtin_expect(__atomic_load_n(&g_log_level, __ATOMIC_RELAXED) \
+                    >= log_fmt_level[fmt], 0)) { \
+            _log_add(fmt, node, (long long) (a), (long long) (b), (long long) (c)); \
+        } \
+    } while (0)
+
+/**
+ * \brief   add record to ring of calling thread, creating ring on first use
+ */
+static void
+_log_add(btelog_fmt_t fmt, unsigned int node, long long a, long long b, 
+        long long c)
+{
+    log_ring_t *ring = t_log_ring;
+    btelog_rec_t *rec = NULL;
+
+    if (ring == NULL) {
+        if ((ring = calloc(1, sizeof(*ring))) == NULL) {
+            return;
+        }
+        ring->thread = __atomic_fetch_add(&g_log_threads, 1, __ATOMIC_RELAXED);
+        ring->next = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(&g_log_rings, &ring->next, ring, 
+                    1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        }
+        t_log_ring = ring;
+    }
+    rec = &ring->recs[ring->head & (LOG_RING_SIZE - 1)];
+    rec->ts = _now_ns();
+    rec->fmt = fmt;
+    rec->thread = ring->thread;
+    rec->node = node;
+    rec->args[0] = a;
+    rec->args[1] = b;
+    rec->args[2] = c;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+static void
+nodeSetState(bt_tree_t *tree, unsigned int idx, rc_t state_rc) 
+{
+    rc_t prev_rc = tree->state[idx].rc;
+
+    tree->state[idx].rc = state_rc;
+    if (state_rc != prev_rc) {
+        btlog(LOG_NODE_STATE, idx, state_rc, prev_rc, 0);
+    }
+    if (state_rc != RC_RUNNING && NODE(tree, idx)->timeout_ms) {
+        _timer_cancel(tree, TIMER_ID(idx, TIMER_TIMEOUT));
+    }
+    if (tree->ckpt && state_rc == RC_SUCCESS && state_rc != prev_rc) {
+        _ckpt_add(tree, CKPT_NODE, idx, NULL, 0);
+    }
+    if (tree->trace && state_rc != prev_rc) {
+        _trace_add(tree, TRACE_STATE, idx, _now_ns(), 0, state_rc, prev_rc);
+    }
+    if (tree->result_cb && state_rc != prev_rc && state_rc != RC_RUNNING) {
+        tree->result_cb(tree->result_ctx, NODE_STR(tree, NODE(tree, idx)->id), 
+                (bte_rc_t) state_rc);
+    }
+}
+
+static const char * 
+rc2rstr(const int rc) {
+    int i = 0;
+    for (; rcs_str_mapping[i].code != RC_UNKNOWN; ++i) {
+        if(rcs_str_mapping[i].code == rc) {
+            return(rcs_str_mapping[i].str);
+        }
+    }
+    return NULL;
+}
+
+static int
+_grow(void **buf, size_t *size, size_t need, size_t item_size)
+{
+    size_t new_size = *size ? *size : 16;
+    void *p = NULL;
+
+    if (need <= *size) {
+        return 0;
+    }
+    while (new_size < need) {
+        new_size *= 2;
+    }
+    if ((p = realloc(*buf, new_size * item_size)) == NULL) {
+        return -1;
+    }
+    *buf = p;
+    *size = new_size;
+    return 0;
+}
+
+/**
+ * \brief   allocate zeroed memory from arena
+ * \return:
+ *  memory - success
+ *  NULL - error
+ */
+static void *
+_arena_alloc(arena_t *arena, size_t size)
+{
+    arena_block_t *block = NULL;
+    void *p = NULL;
+
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    for (block = arena->cur; block; block = block->next) {
+        if (block->size - block->used >= size) {
+            break;
+        }
+    }
+    if (!block) {
+        // big requests get own block
+        if ((block = malloc(sizeof(arena_block_t) + 
+                        (size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE))) == NULL) {
+            return NULL;
+        }
+        block->size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block->used = 0;
+        arena->bytes += block->size;
+        if (arena->cur) {
+            block->next = arena->cur->next;
+            arena->cur->next = block;
+        } else {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+    arena->cur = block;
+    p = block->data + block->used;
+    block->used += size;
+    memset(p, 0, size);
+    return p;
+}
+
+static char *
+_arena_strndup(arena_t *arena, const char *str, size_t len)
+{
+    char *p = NULL;
+
+    if ((p = _arena_alloc(arena, len + 1)) != NULL) {
+        memcpy(p, str, len);
+    }
+    return p;
+}
+
+/**
+ * \brief   make all memory of arena free again, blocks are kept
+ */
+static void
+_arena_reset(arena_t *arena)
+{
+    arena_block_t *block = NULL;
+
+    for (block = arena->head; block; block = block->next) {
+        block->used = 0;
+    }
+    arena->cur = arena->head;
+}
+
+/**
+ * \brief   release blocks of arena
+ */
+static void
+_arena_free(arena_t *arena)
+{
+    arena_block_t *block = NULL;
+
+    while ((block = arena->head) != NULL) {
+        arena->head = block->next;
+        free(block);
+    }
+    arena->cur = NULL;
+    arena->bytes = 0;
+}
+
+/**
+ * \brief   print element reader is positioned at, for compile errors
+ */
+static void 
+_xmlDump(xmlTextReaderPtr reader) 
+{
+  xmlNodePtr node = xmlTextReaderCurrentNode(reader);
+
+  if (node) {
+    printf("source line: %d\n", node->line);
+    xmlDebugDumpOneNode(stdout, node, -1);
+  }
+
+  if (g_debug) {
+    ullog_debug("element %p depth %d type %d name %s empty %d", 
+        node, xmlTextReaderDepth(reader), xmlTextReaderNodeType(reader), 
+        xmlTextReaderConstName(reader), xmlTextReaderIsEmptyElement(reader));
+  }
+}
+
+static long long
+_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long long
+_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int
+_set_nonblock(int fd)
+{
+    int opt = fcntl(fd, F_GETFL);
+
+    if (opt < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, opt | O_NONBLOCK);
+}
+
+static int
+reactorInit(reactor_t *reactor)
+{
+    memset(reactor, 0, sizeof(reactor_t));
+    reactor->epfd = -1;
+    reactor->wheel.now = _now_ms();
+#ifdef __linux__
+    if ((reactor->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        ullog_err("cannot create epoll instance: %s", strerror(errno));
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static void
+reactorFree(reactor_t *reactor)
+{
+    if (reactor->epfd >= 0) close(reactor->epfd);
+    if (reactor->waits) free(reactor->waits);
+    memset(reactor, 0, sizeof(reactor_t));
+    reactor->epfd = -1;
+}
+
+static void
+_reactor_ctl(reactor_t *reactor, int op, int fd, int events, unsigned int idx)
+{
+#ifdef __linux__
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = ((events & IO_READ) ? EPOLLIN : 0) | 
+        ((events & IO_WRITE) ? EPOLLOUT : 0);
+    ev.data.u32 = idx;
+    if (epoll_ctl(reactor->epfd, op, fd, &ev) && op != EPOLL_CTL_DEL) {
+        ullog_err("cannot register fd %d in epoll: %s", fd, strerror(errno));
+    }
+#endif
+}
+
+#define WHEEL_TIMER(tree, id) (&(tree)->state[(id) / TIMER_KINDS].timers[(id) % TIMER_KINDS])
+
+/**
+ * \brief   link timer into slot of wheel by time left until it expires, 
+ *  level l holds timers expiring in 64^l to 64^(l+1) ms
+ */
+static void
+_wheel_link(bt_tree_t *tree, unsigned int id)
+{
+    timer_wheel_t *wheel = &tree->reactor.wheel;
+    wheel_timer_t *t = WHEEL_TIMER(tree, id);
+    long long expires = t->expires;
+    unsigned int level = 0;
+    unsigned int slot = 0;
+
+    if (expires < wheel->now) {
+        expires = wheel->now;
+    } else if (expires - wheel->now >= WHEEL_SPAN) {
+        // far timer waits in last level and cascades again
+        expires = wheel->now + WHEEL_SPAN - 1;
+    }
+    while (level < WHEEL_LEVELS - 1 && 
+            expires - wheel->now >= 1LL << (WHEEL_BITS * (level + 1))) {
+        ++level;
+    }
+    slot = level * WHEEL_SLOTS + ((expires >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    t->slot = slot + 1;
+    t->prev = 0;
+    t->next = wheel->heads[slot];
+    if (t->next) {
+        WHEEL_TIMER(tree, t->next - 1)->prev = id + 1;
+    }
+    wheel->heads[slot] = id + 1;
+    wheel->used[level] |= 1ULL << (slot & WHEEL_MASK);
+}
+
+static void
+_wheel_unlink(bt_tree_t *tree, unsigned int id)
+{
+    timer_wheel_t *wheel = &tree->reactor.wheel;
+    wheel_timer_t *t = WHEEL_TIMER(tree, id);
+    unsigned int slot = t->slot - 1;
+
+    if (t->prev) {
+        WHEEL_TIMER(tree, t->prev - 1)->next = t->next;
+    } else {
+        wheel->heads[slot] = t->next;
+    }
+    if (t->next) {
+        WHEEL_TIMER(tree, t->next - 1)->prev = t->prev;
+    }
+    if (!wheel->heads[slot]) {
+        wheel->used[slot / WHEEL_SLOTS] &= ~(1ULL << (slot & WHEEL_MASK));
+    }
+    t->slot = 0;
+}
+
+/**
+ * \brief   arm timer of node to expire at monotonic ms, 
+ *  armed timer is moved
+ */
+static void
+_timer_arm(bt_tree_t *tree, unsigned int id, long long expires)
+{
+    wheel_timer_t *t = WHEEL_TIMER(tree, id);
+
+    if (t->slot) {
+        _wheel_unlink(tree, id);
+    } else {
+        ++tree->reactor.wheel.armed_n;
+    }
+    t->expires = expires;
+    _wheel_link(tree, id);
+}
+
+static void
+_timer_cancel(bt_tree_t *tree, unsigned int id)
+{
+    if (WHEEL_TIMER(tree, id)->slot) {
+        _wheel_unlink(tree, id);
+        --tree->reactor.wheel.armed_n;
+    }
+}
+
+/**
+ * \brief   expire timers of wheel up to monotonic ms to, 
+ *  nodes of expired timers are marked ready
+ * \return:
+ *  number of expired timers
+ */
+static int
+_wheel_advance(bt_tree_t *tree, long long to)
+{
+    timer_wheel_t *wheel = &tree->reactor.wheel;
+    bt_state_t *st = NULL;
+    unsigned int level = 0;
+    unsigned int slot = 0;
+    unsigned int id = 0;
+    unsigned int next = 0;
+    unsigned long long later = 0;
+    int n = 0;
+
+    while (wheel->now <= to) {
+        if (!wheel->armed_n) {
+            wheel->now = to + 1;
+            break;
+        }
+        // on boundary of level its next slot moves down
+        for (level = 1; level < WHEEL_LEVELS; ++level) {
+            if (wheel->now & ((1LL << (WHEEL_BITS * level)) - 1)) {
+                break;
+            }
+            slot = level * WHEEL_SLOTS + ((wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+            id = wheel->heads[slot];
+            wheel->heads[slot] = 0;
+            wheel->used[level] &= ~(1ULL << (slot & WHEEL_MASK));
+            for (; id; id = next) {
+                next = WHEEL_TIMER(tree, id - 1)->next;
+                _wheel_link(tree, id - 1);
+            }
+        }
+        slot = wheel->now & WHEEL_MASK;
+        while ((id = wheel->heads[slot]) != 0) {
+            st = &tree->state[(id - 1) / TIMER_KINDS];
+            _wheel_unlink(tree, id - 1);
+            --wheel->armed_n;
+            if ((id - 1) % TIMER_KINDS == TIMER_TIMEOUT) {
+                st->timed_out = 1;
+            }
+            st->ready = 1;
+            ++n;
+        }
+        // skip to next used slot of level 0 or next boundary of level 1
+        later = slot == WHEEL_MASK ? 0 : wheel->used[0] >> (slot + 1);
+        wheel->now = later ? wheel->now + 1 + __builtin_ctzll(later) : 
+            (wheel->now | WHEEL_MASK) + 1;
+    }
+    if (wheel->now > to + 1) {
+        wheel->now = to + 1;
+    }
+    return n;
+}
+
+/**
+ * \brief   time of next expiry or cascade of wheel, 
+ *  which is not later than expiry of any timer
+ * \return:
+ *  monotonic ms
+ */
+static long long
+_wheel_next(const timer_wheel_t *wheel)
+{
+    long long next = wheel->now + WHEEL_SPAN;
+    long long t = 0;
+    long long first = 0;
+    unsigned long long rot = 0;
+    unsigned int level = 0;
+    unsigned int start = 0;
+
+    for (level = 0; level < WHEEL_LEVELS; ++level) {
+        if (!wheel->used[level]) {
+            continue;
+        }
+        // slots of level in order they are reached from first boundary on
+        first = (wheel->now + (1LL << (WHEEL_BITS * level)) - 1) >> (WHEEL_BITS * level);
+        start = first & WHEEL_MASK;
+        rot = start ? (wheel->used[level] >> start) | 
+            (wheel->used[level] << (WHEEL_SLOTS - start)) : wheel->used[level];
+        t = (first + __builtin_ctzll(rot)) << (WHEEL_BITS * level);
+        if (t < next) next = t;
+    }
+    return next;
+}
+
+/**
+ * \brief   stop waiting of node for fd readiness and deadline
+ */
+static void
+nodeWaitDone(bt_tree_t *tree, unsigned int idx)
+{
+    reactor_t *reactor = &tree->reactor;
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+
+    if (st->io_fd >= 0) {
+        for (i = 0; i < reactor->waits_n; ++i) {
+            if (reactor->waits[i].idx == idx) {
+#ifdef __linux__
+                _reactor_ctl(reactor, EPOLL_CTL_DEL, reactor->waits[i].fd, 0, idx);
+#endif
+                reactor->waits[i] = reactor->waits[--reactor->waits_n];
+                break;
+            }
+        }
+        st->io_fd = -1;
+    }
+    if (st->deadline) {
+        _timer_cancel(tree, TIMER_ID(idx, TIMER_WAIT));
+        st->deadline = 0;
+    }
+    st->ready = 0;
+}
+
+/**
+ * \brief   make node wait until fd is ready for events
+ *  only one node can wait for fd, new waiter takes fd over
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+nodeWaitIo(bt_tree_t *tree, unsigned int idx, int fd, int events)
+{
+    reactor_t *reactor = &tree->reactor;
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+    unsigned int other = 0;
+
+    if (st->io_fd >= 0 && st->io_fd != fd) {
+        nodeWaitDone(tree, idx);
+    }
+    for (i = 0; i < reactor->waits_n; ++i) {
+        if (reactor->waits[i].fd == fd) {
+            break;
+        }
+    }
+    if (i < reactor->waits_n) {
+        if (reactor->waits[i].idx == idx && reactor->waits[i].events == events) {
+            return 0;
+        }
+        other = reactor->waits[i].idx;
+        if (other != idx) {
+            btlog(LOG_IO_TAKEOVER, idx, fd, other, 0);
+            tree->state[other].io_fd = -1;
+            tree->state[other].ready = 1;
+        }
+#ifdef __linux__
+        _reactor_ctl(reactor, EPOLL_CTL_MOD, fd, events, idx);
+#endif
+    } else {
+        if (_grow((void **) &reactor->waits, &reactor->waits_size, 
+                    reactor->waits_n + 1, sizeof(io_wait_t))) {
+            ullog_err("cannot allocate reactor wait");
+            return -1;
+        }
+        ++reactor->waits_n;
+#ifdef __linux__
+        _reactor_ctl(reactor, EPOLL_CTL_ADD, fd, events, idx);
+#endif
+    }
+    reactor->waits[i].fd = fd;
+    reactor->waits[i].events = events;
+    reactor->waits[i].idx = idx;
+    st->io_fd = fd;
+    return 0;
+}
+
+/**
+ * \brief   make node wait until ms milliseconds pass
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+nodeWaitTimer(bt_tree_t *tree, unsigned int idx, long long ms)
+{
+    bt_state_t *st = &tree->state[idx];
+
+    st->deadline = _now_ms() + ms;
+    _timer_arm(tree, TIMER_ID(idx, TIMER_WAIT), st->deadline);
+    return 0;
+}
+
+
+/**
+ * \brief   time until some node of tree must run without fd readiness
+ * \return:
+ *  N - milliseconds, 0 if some node runs without waiting
+ *  -1 - nodes wait for fds only
+ */
+static long long
+reactorTimeout(bt_tree_t *tree)
+{
+    reactor_t *reactor = &tree->reactor;
+    long long timeout = -1;
+
+    if (reactor->busy) {
+        return 0;
+    } else if (!reactor->waits_n && !reactor->wheel.armed_n) {
+        btlog(LOG_WAIT_NONE, BTELOG_NO_NODE, 0, 0, 0);
+        return 0;
+    }
+    if (reactor->wheel.armed_n) {
+        timeout = _wheel_next(&reactor->wheel) - _now_ms();
+        if (timeout < 0) timeout = 0;
+    }
+    return timeout;
+}
+
+/**
+ * \brief   wait at most timeout ms until fd of some node is ready 
+ *  or its deadline passes and mark such nodes ready
+ * \return:
+ *  N - number of nodes marked ready
+ *  -1 - error
+ */
+static int
+reactorWait(bt_tree_t *tree, long long timeout)
+{
+    reactor_t *reactor = &tree->reactor;
+    unsigned int i = 0;
+    int n = 0;
+    int ready_n = 0;
+#ifdef __linux__
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+#else
+    struct pollfd *pfds = NULL;
+#endif
+
+    reactor->busy = 0;
+    btlog(LOG_WAIT, BTELOG_NO_NODE, reactor->waits_n, reactor->wheel.armed_n, timeout);
+
+#ifdef __linux__
+    n = epoll_wait(reactor->epfd, events, REACTOR_MAX_EVENTS, (int) timeout);
+    if (n < 0 && errno != EINTR) {
+        ullog_err("epoll wait failed: %s", strerror(errno));
+        return -1;
+    }
+    for (i = 0; (int) i < n; ++i) {
+        tree->state[events[i].data.u32].ready = 1;
+        ++ready_n;
+    }
+#else
+    if (reactor->waits_n) {
+        if ((pfds = _arena_alloc(&tree->scratch, 
+                        reactor->waits_n * sizeof(struct pollfd))) == NULL) {
+            ullog_err("cannot allocate poll fds");
+            return -1;
+        }
+    }
+    for (i = 0; i < reactor->waits_n; ++i) {
+        pfds[i].fd = reactor->waits[i].fd;
+        pfds[i].events = ((reactor->waits[i].events & IO_READ) ? POLLIN : 0) | 
+            ((reactor->waits[i].events & IO_WRITE) ? POLLOUT : 0);
+    }
+    n = poll(pfds, reactor->waits_n, (int) timeout);
+    if (n < 0 && errno != EINTR) {
+        ullog_err("poll failed: %s", strerror(errno));
+        return -1;
+    }
+    for (i = 0; n > 0 && i < reactor->waits_n; ++i) {
+        if (pfds[i].revents) {
+            tree->state[reactor->waits[i].idx].ready = 1;
+            ++ready_n;
+        }
+    }
+#endif
+
+    ready_n += _wheel_advance(tree, _now_ms());
+    return ready_n;
+}
+
+/**
+ * \brief   write asynchronously as much of buffer as fd accepts
+ * \return:
+ *  N - number of bytes written, less than len if receiver is not ready
+ *  -1 - error, error number is in errno 
+ */
+static ssize_t
+async_write(int fd, const char *buf, size_t len)
+{
+    size_t tn = 0;
+    ssize_t n = 0;
+
+    while (tn < len) {
+        errno = 0;
+        n = write(fd, buf + tn, len - tn);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        tn += n;
+    }
+    return tn;
+}
+
+/**
+ * \brief   decode '\n', '\r', '\t' and '\\' escapes of write payload in place
+ * \return:
+ *  length of decoded payload
+ */
+static size_t
+_unescape(char *buf, size_t len)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    for (i = 0; i < len; ++i) {
+        if (buf[i] != '\\' || i + 1 == len) {
+            buf[j++] = buf[i];
+            continue;
+        }
+        ++i;
+        switch (buf[i]) {
+        case 'n':
+            buf[j++] = '\n';
+            break;
+        case 'r':
+            buf[j++] = '\r';
+            break;
+        case 't':
+            buf[j++] = '\t';
+            break;
+        default:
+            buf[j++] = buf[i];
+            break;
+        }
+    }
+    buf[j] = '\0';
+    return j;
+}
+
+/**
+ * \brief   spawn command with stdout and stderr going to one pipe, 
+ *  simple commands run directly, others by shell, command which 
+ *  cannot run gets engine message in pipe and pid 0
+ * \return:
+ *  N - non blocking read end of pipe, pid of command is in pid
+ *  -1 - error
+ */
+static int
+_exec_spawn(arena_t *scratch, const char *cmd, int shell, pid_t *pid)
+{
+    int fds[2] = {-1, -1};
+    posix_spawn_file_actions_t fa;
+    char *cmdcp = NULL;
+    char **argv = NULL;
+    int argc = 0;
+    char *token = NULL;
+    char *save = NULL;
+    char *sh_argv[] = {"sh", "-c", NULL, NULL};
+    char msg[256] = "";
+    size_t len = 0;
+    int rc = -1;
+
+    // write end must not leak into commands spawned by other threads, 
+    // its output would not end before they do
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC)) {
+#else
+    if (pipe(fds)) {
+#endif
+        ullog_err("cannot create pipe: %s", strerror(errno));
+        return -1;
+    }
+    if (
+#ifndef __linux__
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC) || fcntl(fds[1], F_SETFD, FD_CLOEXEC) || 
+#endif
+            _set_nonblock(fds[0])) {
+        ullog_err("cannot set flags of pipe: %s", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, fds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&fa, fds[1]);
+
+    if (!shell) {
+        // command of n bytes has at most n / 2 + 1 words
+        len = strlen(cmd);
+        if ((cmdcp = _arena_strndup(scratch, cmd, len)) == NULL || 
+                (argv = _arena_alloc(scratch, (len / 2 + 2) * sizeof(char *))) == NULL) {
+            ullog_err("cannot allocate command arguments");
+            goto bail;
+        }
+        for (token = strtok_r(cmdcp, " \t", &save); token; 
+                token = strtok_r(NULL, " \t", &save)) {
+            argv[argc++] = token;
+        }
+        if (argc) {
+            argv[argc] = NULL;
+            rc = posix_spawnp(pid, argv[0], &fa, NULL, argv, environ);
+        }
+        // command which cannot run fails like shell exiting with 127 
+        // and prints shell message, only script without interpreter 
+        // line is left to shell
+        if (argc && rc && rc != ENOEXEC) {
+            snprintf(msg, sizeof(msg), "sh: %s: %s\n", argv[0], 
+                    rc == ENOENT ? "command not found" : strerror(rc));
+            if (write(fds[1], msg, strlen(msg)) < 0) {
+                ullog_err("cannot write error of command '%s'", cmd);
+            }
+            *pid = 0;
+            rc = 0;
+        }
+    }
+    if (rc) {
+        // shell runs compound commands
+        sh_argv[2] = (char *) cmd;
+        rc = posix_spawn(pid, EXEC_SHELL, &fa, NULL, sh_argv, environ);
+    }
+    if (rc) {
+        ullog_err("cannot spawn command '%s': %s", cmd, strerror(rc));
+    }
+
+    bail:
+    posix_spawn_file_actions_destroy(&fa);
+    close(fds[1]);
+    if (rc) {
+        close(fds[0]);
+        return -1;
+    }
+    return fds[0];
+}
+
+/**
+ * \brief   write whole buffer to blocking fd
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_sink_write(int fd, const char *buf, size_t len)
+{
+    ssize_t n = 0;
+
+    // keep order with buffered stdio output
+    fflush(stdout);
+    while (len) {
+        n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * \brief   close output of exec node and wait for its process, 
+ *  process is killed first if sig is not 0
+ * \return:
+ *  0 - process exited with zero status
+ *  -1 - process failed or there was no process
+ */
+static int
+_exec_reap(bt_state_t *st, int sig)
+{
+    int status = 0;
+    int rc = -1;
+
+    if (st->out_fd >= 0) {
+        close(st->out_fd);
+        st->out_fd = -1;
+    }
+    if (st->pid > 0) {
+        if (sig) kill(st->pid, sig);
+        while (waitpid(st->pid, &status, 0) < 0 && errno == EINTR);
+        btlog(LOG_REAP, BTELOG_NO_NODE, st->pid, status, 0);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            rc = 0;
+        }
+        st->pid = 0;
+    }
+    return rc;
+}
+
+/**
+ * \brief   key of exec cache, command of node is run same way 
+ *  only with same environment and working directory
+ * \return:
+ *  key in scratch arena, NULL on error
+ */
+static char *
+_exec_cache_key(bt_tree_t *tree, unsigned int idx, size_t *len)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    unsigned long long hash = 14695981039346656037ULL; // FNV-1a
+    char cwd[PATH_MAX] = "";
+    char **env = NULL;
+    const char *p = NULL;
+    char *key = NULL;
+
+    for (env = environ; env && *env; ++env) {
+        for (p = *env; *p; ++p) {
+            hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+        }
+        hash = (hash ^ '\n') * 1099511628211ULL;
+    }
+    if (getcwd(cwd, sizeof(cwd))) {
+        for (p = cwd; *p; ++p) {
+            hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+        }
+    }
+    *len = sizeof(hash) + n->value_len;
+    if ((key = _arena_alloc(&tree->scratch, *len)) == NULL) {
+        return NULL;
+    }
+    memcpy(key, &hash, sizeof(hash));
+    memcpy(key + sizeof(hash), NODE_STR(tree, n->value), n->value_len);
+    return key;
+}
+
+/**
+ * \brief   remove entry from exec cache, called with cache locked
+ */
+static void
+_exec_cache_drop(exec_cache_t *item, size_t len)
+{
+    HASH_DEL(g_exec_cache, item);
+    g_exec_cache_bytes -= len + item->out_size;
+    free(item->key);
+    free(item->out);
+    free(item);
+}
+
+/**
+ * \brief   finish exec node with result cached by other run of its 
+ *  command, output is forwarded or captured as if command ran, 
+ *  expired entry is removed
+ * \return:
+ *  RC_SUCCESS, RC_FAILURE - cached result
+ *  RC_UNKNOWN - no result or it expired, command must run
+ *  RC_ERROR - error
+ */
+static rc_t
+_exec_cache_get(bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    unsigned int slot = n->var ? _var_resolve(tree, idx, n->var) : 0;
+    bb_var_t *var = slot ? &tree->vars[slot] : NULL;
+    char **out_buf = var ? &var->buf : &tree->out_buf;
+    size_t *out_size = var ? &var->size : &tree->out_size;
+    exec_cache_t *item = NULL;
+    rc_t task_rc = RC_UNKNOWN;
+    size_t out_len = 0;
+    size_t len = 0;
+    char *key = NULL;
+
+    if ((key = _exec_cache_key(tree, idx, &len)) == NULL) {
+        return RC_UNKNOWN;
+    }
+    pthread_mutex_lock(&g_exec_cache_lock);
+    HASH_FIND(hh, g_exec_cache, key, len, item);
+    if (item && item->expires <= _now_ms()) {
+        _exec_cache_drop(item, len);
+        item = NULL;
+    }
+    if (item) {
+        if (_grow((void **) out_buf, out_size, item->out_len + 1, 1)) {
+            task_rc = RC_ERROR;
+        } else {
+            if (item->out_len) memcpy(*out_buf, item->out, item->out_len);
+            out_len = item->out_len;
+            task_rc = item->rc;
+        }
+        // hit entry becomes most recently used
+        HASH_DEL(g_exec_cache, item);
+        HASH_ADD_KEYPTR(hh, g_exec_cache, item->key, len, item);
+    }
+    pthread_mutex_unlock(&g_exec_cache_lock);
+    if (task_rc == RC_UNKNOWN) {
+        return task_rc;
+    }
+    if (task_rc == RC_ERROR) {
+        ullog_err("cannot allocate exec output buffer");
+        return task_rc;
+    }
+    btlog(LOG_EXEC_CACHED, idx, task_rc, out_len, 0);
+    ++tree->stats.cache_hits;
+    if (var) {
+        var->kind = VAR_TEXT;
+        var->len = out_len;
+        if (tree->ckpt) _ckpt_add(tree, CKPT_VAR, slot, var->buf, var->len);
+    } else if (out_len && treeOutput(tree, tree->out_buf, out_len)) {
+        ullog_err("cannot forward output of command '%s'", NODE_STR(tree, n->value));
+        task_rc = RC_ERROR;
+    }
+    return task_rc;
+}
+
+/**
+ * \brief   keep result and output of finished exec node for its 
+ *  cache_ttl_ms, result of command cached before is replaced, 
+ *  new entry sweeps expired ones and least recently used entries 
+ *  go while cache holds more than EXEC_CACHE_MAX
+ */
+static void
+_exec_cache_put(bt_tree_t *tree, unsigned int idx, rc_t task_rc)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    exec_cache_t *item = NULL;
+    exec_cache_t *old = NULL;
+    exec_cache_t *tmp = NULL;
+    long long now = _now_ms();
+    size_t len = 0;
+    char *key = NULL;
+
+    if ((key = _exec_cache_key(tree, idx, &len)) == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&g_exec_cache_lock);
+    HASH_FIND(hh, g_exec_cache, key, len, item);
+    if (st->cache_skip) {
+        if (item) _exec_cache_drop(item, len);
+        goto bail;
+    }
+    if (item) {
+        // replaced entry becomes most recently used
+        HASH_DEL(g_exec_cache, item);
+        g_exec_cache_bytes -= len + item->out_size;
+    } else {
+        HASH_ITER(hh, g_exec_cache, old, tmp) {
+            if (old->expires <= now) {
+                _exec_cache_drop(old, old->hh.keylen);
+            }
+        }
+        if ((item = calloc(1, sizeof(exec_cache_t))) == NULL || 
+                (item->key = malloc(len)) == NULL) {
+            ullog_err("cannot allocate exec cache entry");
+            free(item);
+            goto bail;
+        }
+        memcpy(item->key, key, len);
+    }
+    HASH_ADD_KEYPTR(hh, g_exec_cache, item->key, len, item);
+    if (_grow((void **) &item->out, &item->out_size, st->cache_len + 1, 1)) {
+        ullog_err("cannot allocate exec cache output");
+        g_exec_cache_bytes += len + item->out_size;
+        _exec_cache_drop(item, len);
+        goto bail;
+    }
+    g_exec_cache_bytes += len + item->out_size;
+    if (st->cache_len) memcpy(item->out, st->cache_buf, st->cache_len);
+    item->out_len = st->cache_len;
+    item->rc = task_rc;
+    item->expires = now + n->cache_ttl_ms;
+    while (g_exec_cache_bytes > EXEC_CACHE_MAX && g_exec_cache != item) {
+        _exec_cache_drop(g_exec_cache, g_exec_cache->hh.keylen);
+    }
+
+    bail:
+    pthread_mutex_unlock(&g_exec_cache_lock);
+}
+
+static rc_t 
+processActionExec(bt_tree_t *tree, unsigned int idx) 
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_FAILURE;
+    const char *node_id = NODE_STR(tree, n->id);
+    const char *action_value = NODE_STR(tree, n->value);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int slot = n->var ? _var_resolve(tree, idx, n->var) : 0;
+    bb_var_t *var = slot ? &tree->vars[slot] : NULL;
+    char **out_buf = var ? &var->buf : &tree->out_buf;
+    size_t *out_size = var ? &var->size : &tree->out_size;
+    size_t out_base = 0;
+    size_t out_len = 0;
+    ssize_t nread = 0;
+    long long t0 = 0;
+
+    if (st->rc != RC_RUNNING) {
+        if (n->cache_ttl_ms && 
+                (task_rc = _exec_cache_get(tree, idx)) != RC_UNKNOWN) {
+            goto bail;
+        }
+        task_rc = RC_FAILURE;
+        if (n->value_len > 0) {
+            t0 = g_stats || tree->trace ? _now_ns() : 0;
+            st->out_fd = _exec_spawn(&tree->scratch, action_value, n->shell, &st->pid);
+            if (tree->trace) {
+                _trace_span(tree, TRACE_SPAWN, idx, t0, st->out_fd < 0 ? RC_ERROR : RC_SUCCESS);
+            }
+            if (st->out_fd < 0) {
+                ullog_err("cannot execute command '%s'", action_value);
+                task_rc = RC_ERROR;
+                goto bail;
+            }
+            ++tree->stats.spawns;
+            if (g_stats) tree->stats.spawn_ns += _now_ns() - t0;
+            btlog(LOG_SPAWN, idx, st->pid, st->out_fd, 0);
+            if (var) {
+                var->kind = VAR_TEXT;
+                var->len = 0;
+            }
+            st->cache_len = 0;
+            st->cache_skip = 0;
+        } else {
+            ullog_err("cannot read command value or it is empty");
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+    }
+
+    if(st->out_fd < 0) {
+        ullog_err("cannot find output of node id '%s'", node_id);
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    // drain all available output, forward it with one write, 
+    // captured output is read straight into its variable
+    out_base = var ? var->len : 0;
+    do {
+        if (_grow((void **) out_buf, out_size, 
+                    out_base + out_len + EXEC_READ_SIZE, 1)) {
+            ullog_err("cannot allocate exec output buffer");
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+        errno = 0;
+        nread = read(st->out_fd, *out_buf + out_base + out_len, 
+                *out_size - out_base - out_len);
+        if (nread > 0) {
+            out_len += nread;
+        }
+    } while ((nread > 0 || (nread < 0 && errno == EINTR)) && 
+            out_len < EXEC_DRAIN_MAX);
+    if (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        ullog_err("cannot read output of command '%s'", action_value);
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+    btlog(LOG_EXEC_READ, idx, out_len, 0, 0);
+    // output too big for cache is not collected
+    if (n->cache_ttl_ms && out_len && !st->cache_skip && 
+            st->cache_len + out_len > EXEC_CACHE_ENTRY_MAX) {
+        st->cache_skip = 1;
+        st->cache_len = 0;
+    }
+    if (n->cache_ttl_ms && out_len && !st->cache_skip) {
+        if (_grow((void **) &st->cache_buf, &st->cache_size, 
+                    st->cache_len + out_len, 1)) {
+            ullog_err("cannot allocate exec cache buffer");
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+        memcpy(st->cache_buf + st->cache_len, *out_buf + out_base, out_len);
+        st->cache_len += out_len;
+    }
+    if (var) {
+        var->len += out_len;
+    } else if (out_len && treeOutput(tree, tree->out_buf, out_len)) {
+        ullog_err("cannot forward output of command '%s'", action_value);
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    if (nread == 0) {
+        btlog(LOG_EXEC_EOF, idx, st->out_fd, 0, 0);
+        nodeWaitDone(tree, idx);
+        if(_exec_reap(st, 0) == 0) {
+            task_rc = RC_SUCCESS;
+        } else {
+            task_rc = RC_FAILURE;
+        }
+        if (n->cache_ttl_ms) {
+            _exec_cache_put(tree, idx, task_rc);
+        }
+        if (var && tree->ckpt) {
+            _ckpt_add(tree, CKPT_VAR, slot, var->buf, var->len);
+        }
+    } else {
+        task_rc = RC_RUNNING;
+        if (nodeWaitIo(tree, idx, st->out_fd, IO_READ)) {
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+    }
+
+    bail:
+    if(st->out_fd >= 0 && task_rc == RC_ERROR) {
+        nodeWaitDone(tree, idx);
+        _exec_reap(st, SIGKILL);
+    }
+    return task_rc;
+}
+
+/**
+ * \brief   open stream of node
+ * \return:
+ *  item - success
+ *  NULL - stream is not open or node has no stream
+ */
+static fp_table_t *
+_stream_get(bt_tree_t *tree, const bt_node_t *n)
+{
+    fp_table_t *item = &tree->streams[n->stream];
+
+    return n->stream && item->fd > 0 ? item : NULL;
+}
+
+/**
+ * \brief   reap processes of closed streams which exited, process 
+ *  still running at its deadline gets SIGTERM and later SIGKILL, 
+ *  force kills and waits for all of them
+ */
+static void
+_stream_reap(bt_tree_t *tree, int force)
+{
+    reap_t *item = NULL;
+    unsigned int i = 0;
+    long long now = 0;
+    pid_t rc = 0;
+
+    while (i < tree->reaps_n) {
+        item = &tree->reaps[i];
+        while ((rc = waitpid(item->pid, NULL, WNOHANG)) < 0 && errno == EINTR);
+        if (rc == 0 && force) {
+            kill(item->pid, SIGKILL);
+            while ((rc = waitpid(item->pid, NULL, 0)) < 0 && errno == EINTR);
+        }
+        // reaped or not child any more
+        if (rc != 0) {
+            *item = tree->reaps[--tree->reaps_n];
+            continue;
+        }
+        if (!now) {
+            now = _now_ms();
+        }
+        if (now >= item->deadline) {
+            ullog_info("stream process %d did not exit, sending signal %d", 
+                    (int) item->pid, item->sig);
+            kill(item->pid, item->sig);
+            item->sig = SIGKILL;
+            item->deadline = now + STREAM_REAP_MS;
+        }
+        ++i;
+    }
+}
+
+/**
+ * \brief   close stream and free its slot, process which did not exit 
+ *  on hangup is reaped by later ticks, match states buffer of slot 
+ *  is kept for next open
+ * \return:
+ *  0 - success
+ *  -1 - stream close failed
+ */
+static int
+_stream_close(bt_tree_t *tree, fp_table_t *item)
+{
+    match_state_t ms = item->ms;
+    reap_t *reap = NULL;
+    pid_t pid = 0;
+    int rc = 0;
+
+    if (item->fd > 0 && close(item->fd)) {
+        rc = -1;
+    }
+    // closed pty hangs process up, one ignoring it must not block tree
+    if (item->pid > 0) {
+        while ((pid = waitpid(item->pid, NULL, WNOHANG)) < 0 && errno == EINTR);
+    }
+    if (item->pid > 0 && pid == 0) {
+        if (_grow((void **) &tree->reaps, &tree->reaps_size, 
+                    tree->reaps_n + 1, sizeof(reap_t))) {
+            kill(item->pid, SIGKILL);
+            while (waitpid(item->pid, NULL, 0) < 0 && errno == EINTR);
+        } else {
+            reap = &tree->reaps[tree->reaps_n++];
+            reap->pid = item->pid;
+            reap->sig = SIGTERM;
+            reap->deadline = _now_ms() + STREAM_REAP_MS;
+        }
+    }
+    memset(item, 0, sizeof(fp_table_t));
+    item->ms.nfa = ms.nfa;
+    item->ms.nfa_words = ms.nfa_words;
+    return rc;
+}
+
+static rc_t 
+processActionOpen(bt_tree_t *tree, unsigned int idx) 
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_FAILURE;
+    const char *node_id = NODE_STR(tree, n->id);
+    const char *stream_id = NODE_STR(tree, n->stream_id);
+    const char *action_value = NODE_STR(tree, n->value);
+    bt_state_t *st = &tree->state[idx];
+    fp_table_t *fp_table_item = NULL;
+    int opt = 0;
+    pid_t pid = 0;
+    long long t0 = 0;
+    char **argv = NULL;
+    int argc = 0;
+    char *argvcp = NULL;
+    char *token = NULL;
+    char *save = NULL;
+    const char delim[] = " ";
+
+    if (strlen(stream_id) == 0) {
+        ullog_err("cannot read node stream id");
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    if (st->rc != RC_RUNNING) {
+        if (n->value_len > 0) {
+            if ((fp_table_item = _stream_get(tree, n)) != NULL) {
+                ullog_info("stream id '%s' is reopened", stream_id);
+                _stream_close(tree, fp_table_item);
+            }
+            fp_table_item = &tree->streams[n->stream];
+
+            // words of command live until end of tick
+            argvcp = _arena_strndup(&tree->scratch, action_value, n->value_len);
+            argv = _arena_alloc(&tree->scratch, (n->value_len / 2 + 2) * sizeof(char *));
+            if (!argvcp || !argv) {
+                ullog_err("cannot allocate command arguments");
+                task_rc = RC_ERROR;
+                goto bail;
+            }
+            for (token = strtok_r(argvcp, delim, &save); token; 
+                    token = strtok_r(NULL, delim, &save)) {
+                argv[argc++] = token;
+            }
+            argv[argc] = (char *) NULL;
+
+            if(g_expect_debug) {
+                exp_is_debugging = 1;
+                exp_loguser = 1;
+                exp_timeout = 0; // return immediately
+            }
+
+            t0 = tree->trace ? _now_ns() : 0;
+            // libexpect returns pid in global
+            pthread_mutex_lock(&g_expect_lock);
+            fp_table_item->fd = exp_spawnv(argv[0], (char **) argv);
+            pid = exp_pid;
+            pthread_mutex_unlock(&g_expect_lock);
+            if (fp_table_item->fd > 0) {
+                fcntl(fp_table_item->fd, F_SETFD, FD_CLOEXEC);
+            }
+            if (tree->trace) {
+                _trace_span(tree, TRACE_SPAWN, idx, t0, 
+                        fp_table_item->fd < 1 ? RC_FAILURE : RC_SUCCESS);
+            }
+            if(!fp_table_item->fd) {
+                ullog_err("cannot execute command '%s'", action_value);
+                task_rc = RC_FAILURE;
+                goto bail;
+            }
+            if(fp_table_item->fd < 1) {
+                ullog_err("cannot open stream for command '%s'", action_value);
+                task_rc = RC_FAILURE;
+                goto bail;
+            }
+
+            opt = fcntl(fp_table_item->fd, F_GETFL);
+            if (opt < 0) {
+                ullog_err("cannot F_GETFL on open command '%s'", action_value);
+                task_rc = RC_ERROR;
+                goto bail;
+            }
+            opt |= O_NONBLOCK;
+            if (fcntl(fp_table_item->fd, F_SETFL, opt) < 0) {
+                ullog_err("cannot F_SETFL on open command '%s'", action_value);
+                task_rc = RC_ERROR;
+                goto bail;
+            }
+            task_rc = RC_SUCCESS;
+
+            fp_table_item->id = (const char *) stream_id;
+            fp_table_item->match_node = -1;
+            fp_table_item->pid = pid;
+            btlog(LOG_STREAM_OPEN, idx, n->stream, fp_table_item->fd, 
+                    fp_table_item->pid);
+        } else {
+            ullog_err("cannot read command value or it is empty");
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+    }
+
+    if(!fp_table_item) {
+        fp_table_item = _stream_get(tree, n);
+    }
+    if(!fp_table_item) {
+        ullog_err("cannot find open stream id for node id '%s'", node_id);
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    bail:
+    // failed spawn leaves slot half filled
+    if(fp_table_item && task_rc != RC_SUCCESS) {
+        _stream_close(tree, fp_table_item);
+    }
+    return task_rc;
+}
+
+static rc_t 
+processActionClose(bt_tree_t *tree, unsigned int idx) 
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_FAILURE;
+    const char *node_id = NODE_STR(tree, n->id);
+    const char *stream_id = NODE_STR(tree, n->stream_id);
+    bt_state_t *st = &tree->state[idx];
+    fp_table_t *fp_table_item = NULL;
+
+    if (strlen(stream_id) == 0) {
+        ullog_err("cannot read node stream id");
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    if (st->rc != RC_RUNNING) {
+        // no values in close action
+        if(!fp_table_item) {
+            fp_table_item = _stream_get(tree, n);
+        }
+        if(!fp_table_item) {
+            btlog(LOG_STREAM_NONE, idx, n->stream, 0, 0);
+            ullog_err("cannot find open stream id for node id '%s'", node_id);
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+
+        task_rc = RC_SUCCESS;
+        errno = 0;
+        btlog(LOG_STREAM_CLOSE, idx, n->stream, fp_table_item->fd, 0);
+        if (_stream_close(tree, fp_table_item)) {
+            task_rc = RC_FAILURE;
+        }
+        fp_table_item = NULL;
+    }
+
+    bail:
+    if(fp_table_item && task_rc == RC_ERROR) {
+        _stream_close(tree, fp_table_item);
+    }
+    return task_rc;
+}
+
+#define MATCH_TOK(tree, m, i) (&(tree)->toks[(m)->toks + (i)])
+#define NFA_HAS(set, i) ((set)[(i) / 64] & (1ULL << ((i) % 64)))
+#define NFA_ADD(set, i) ((set)[(i) / 64] |= (1ULL << ((i) % 64)))
+
+/**
+ * \brief   add states reachable by empty star from states of set
+ */
+static void
+_nfa_closure(bt_tree_t *tree, const matcher_t *m, unsigned long long *set)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < m->toks_n; ++i) {
+        if (MATCH_TOK(tree, m, i)->kind == GLOB_STAR && NFA_HAS(set, i)) {
+            NFA_ADD(set, i + 1);
+        }
+    }
+}
+
+/**
+ * \brief   continue matching of buffer from last scanned byte
+ * \return:
+ *  1 - matched, end of match is in end
+ *  0 - not matched yet
+ */
+static int
+_match_scan(bt_tree_t *tree, const matcher_t *m, const char *buf, size_t len, 
+        match_state_t *ms, size_t *end)
+{
+    size_t pos = 0;
+    size_t words = 0;
+    unsigned long long *cur = NULL;
+    unsigned long long *next = NULL;
+    const char *found = NULL;
+    unsigned int i = 0;
+    unsigned char c = 0;
+
+    if (m->kind == MATCH_LITERAL) {
+        // literal may start in bytes scanned before
+        pos = ms->scanned >= m->lit_len ? ms->scanned - m->lit_len + 1 : 0;
+        if (len >= pos + m->lit_len && (found = memmem(buf + pos, len - pos, 
+                        NODE_STR(tree, m->lit), m->lit_len)) != NULL) {
+            *end = (m->flags & MATCH_CONSUME_ALL) ? len : 
+                (size_t) (found - buf) + m->lit_len;
+            return 1;
+        }
+        ms->scanned = len;
+        return 0;
+    }
+
+    words = (m->toks_n + 1 + 63) / 64;
+    if (ms->nfa_words < 2 * words) {
+        if ((ms->nfa = _arena_alloc(&tree->arena, 
+                        2 * words * sizeof(unsigned long long))) == NULL) {
+            ullog_err("cannot allocate match states");
+            ms->nfa_words = 0;
+            return 0;
+        }
+        ms->nfa_words = 2 * words;
+        ms->scanned = 0;
+    }
+    cur = ms->nfa;
+    next = ms->nfa + words;
+    if (ms->scanned == 0) {
+        memset(cur, 0, words * sizeof(unsigned long long));
+    }
+    for (pos = ms->scanned; ; ++pos) {
+        if (!(m->flags & MATCH_ANCHOR_START) || (pos == 0 && !ms->dropped)) {
+            NFA_ADD(cur, 0);
+            _nfa_closure(tree, m, cur);
+        }
+        if (NFA_HAS(cur, m->toks_n) && (!(m->flags & MATCH_ANCHOR_END) || pos == len)) {
+            *end = (m->flags & MATCH_CONSUME_ALL) ? len : pos;
+            return 1;
+        }
+        if (pos == len) {
+            break;
+        }
+        c = (unsigned char) buf[pos];
+        memset(next, 0, words * sizeof(unsigned long long));
+        for (i = 0; i < m->toks_n; ++i) {
+            if (!NFA_HAS(cur, i)) {
+                continue;
+            }
+            switch (MATCH_TOK(tree, m, i)->kind) {
+            case GLOB_STAR:
+                NFA_ADD(next, i);
+                break;
+            case GLOB_ANY:
+                NFA_ADD(next, i + 1);
+                break;
+            case GLOB_CLASS:
+                if (MATCH_TOK(tree, m, i)->set[c / 8] & (1 << (c % 8))) {
+                    NFA_ADD(next, i + 1);
+                }
+                break;
+            default:
+                if (MATCH_TOK(tree, m, i)->c == c) {
+                    NFA_ADD(next, i + 1);
+                }
+                break;
+            }
+        }
+        _nfa_closure(tree, m, next);
+        memcpy(cur, next, words * sizeof(unsigned long long));
+    }
+    ms->scanned = len;
+    return 0;
+}
+
+/**
+ * \brief   drop first n bytes of stream buffer, match state of 
+ *  scanned bytes is kept, matched bytes leave buffer starting 
+ *  at unmatched output again
+ */
+static void
+_stream_consume(fp_table_t *item, size_t n, int matched)
+{
+    memmove(item->read_buf, item->read_buf + n, item->read_bytes - n);
+    item->read_bytes -= n;
+    item->ms.scanned = item->ms.scanned > n ? item->ms.scanned - n : 0;
+    item->ms.dropped = !matched;
+}
+
+/**
+ * \brief   find slot variable of node idx is stored in, uses of subtree 
+ *  around node are searched from innermost for own slot of variable
+ * \return:
+ *  slot of variable
+ */
+static unsigned int
+_var_resolve(const bt_tree_t *tree, unsigned int idx, unsigned int slot)
+{
+    const bt_node_t *n = NULL;
+    unsigned int use = 0;
+    unsigned int i = 0;
+
+    for (use = tree->state[idx].use; use; use = tree->state[use].use) {
+        n = NODE(tree, use);
+        for (i = 0; i < n->frame_n; ++i) {
+            if (tree->parts[n->tmpl + i].var == slot) {
+                return tree->state[use].frame + i;
+            }
+        }
+    }
+    return slot;
+}
+
+/**
+ * \brief   store copy of bytes as text value of blackboard variable
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_var_set(bt_tree_t *tree, unsigned int slot, const char *buf, size_t len)
+{
+    bb_var_t *var = &tree->vars[slot];
+
+    if (_grow((void **) &var->buf, &var->size, len + 1, 1)) {
+        return -1;
+    }
+    memcpy(var->buf, buf, len);
+    var->len = len;
+    var->kind = VAR_TEXT;
+    if (tree->ckpt) _ckpt_add(tree, CKPT_VAR, slot, var->buf, var->len);
+    return 0;
+}
+
+static rc_t 
+processActionExpect(bt_tree_t *tree, unsigned int idx) 
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_FAILURE;
+    const char *node_id = NODE_STR(tree, n->id);
+    const char *stream_id = NODE_STR(tree, n->stream_id);
+    fp_table_t *fp_table_item = NULL;
+    size_t end = 0;
+    ssize_t rn = 0;
+    int eof = 0;
+    int matched = 0;
+    long long t0 = 0;
+
+    if (strlen(stream_id) == 0) {
+        ullog_err("cannot read node stream id");
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    if (n->value_len > 0) {
+        if(!fp_table_item) {
+            fp_table_item = _stream_get(tree, n);
+        }
+        if(!fp_table_item) {
+            btlog(LOG_STREAM_NONE, idx, n->stream, 0, 0);
+            ullog_err("cannot find open stream id for node id '%s'", node_id);
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+        if(fp_table_item->fd < 1) {
+            ullog_err("stream id is not opened for node id '%s'", node_id);
+            task_rc = RC_FAILURE;
+            goto bail;
+        }
+
+        // first run matches data already buffered, 
+        // next runs scan only bytes arrived since
+        btlog(LOG_STREAM, idx, n->stream, fp_table_item->fd, fp_table_item->read_bytes);
+        if (fp_table_item->match_node != (int) idx) {
+            fp_table_item->match_node = idx;
+            fp_table_item->ms.scanned = 0;
+        }
+
+        // do actual action
+        for (;;) {
+            tree->stats.expect_bytes += fp_table_item->read_bytes - fp_table_item->ms.scanned;
+            t0 = g_stats || tree->trace ? _now_ns() : 0;
+            matched = _match_scan(tree, &tree->matchers[n->matcher], 
+                    fp_table_item->read_buf, fp_table_item->read_bytes, 
+                    &fp_table_item->ms, &end);
+            if (g_stats) tree->stats.expect_ns += _now_ns() - t0;
+            if (tree->trace) {
+                _trace_span(tree, TRACE_MATCH, idx, t0, matched ? RC_SUCCESS : RC_RUNNING);
+            }
+            if (matched) {
+                btlog(LOG_EXPECT_MATCH, idx, end, 0, 0);
+                if (n->var && _var_set(tree, _var_resolve(tree, idx, n->var), 
+                            fp_table_item->read_buf, end)) {
+                    ullog_err("cannot store match of node id '%s'", node_id);
+                    task_rc = RC_ERROR;
+                    break;
+                }
+                _stream_consume(fp_table_item, end, 1);
+                fp_table_item->match_node = -1;
+                task_rc = RC_SUCCESS;
+                break;
+            }
+            if (eof) {
+                btlog(LOG_EXPECT_EOF, idx, fp_table_item->read_bytes, 0, 0);
+                task_rc = RC_FAILURE;
+                break;
+            }
+            if (fp_table_item->read_bytes == STREAM_BUF_SIZE) {
+                // forget oldest output like match_max of expect
+                _stream_consume(fp_table_item, STREAM_BUF_SIZE / 2, 0);
+            }
+            errno = 0;
+            rn = read(fp_table_item->fd, 
+                    fp_table_item->read_buf + fp_table_item->read_bytes, 
+                    STREAM_BUF_SIZE - fp_table_item->read_bytes);
+            if (rn > 0) {
+                if (g_expect_debug) {
+                    fwrite(fp_table_item->read_buf + fp_table_item->read_bytes, 
+                            1, rn, stdout);
+                }
+                fp_table_item->read_bytes += rn;
+            } else if (rn < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                btlog(LOG_EXPECT_WAIT, idx, fp_table_item->read_bytes, 0, 0);
+                task_rc = RC_RUNNING;
+                if (nodeWaitIo(tree, idx, fp_table_item->fd, IO_READ)) {
+                    task_rc = RC_ERROR;
+                }
+                break;
+            } else if (rn == 0 || errno != EINTR) {
+                // pty reports closed peer as EIO
+                eof = 1;
+            }
+        }
+
+    } else {
+        ullog_err("cannot read command value or it is empty");
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    //if(g_debug) sleep(1);
+
+    bail:
+    if(fp_table_item && task_rc == RC_ERROR) {
+        _stream_close(tree, fp_table_item);
+    }
+    return task_rc;
+}
+
+/**
+ * \brief   expand write template of node with current variable values, 
+ *  unset variables expand to nothing
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_tmpl_expand(bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    const tmpl_part_t *part = NULL;
+    const bb_var_t *var = NULL;
+    size_t len = 0;
+    unsigned int i = 0;
+
+    for (i = 0; i < n->tmpl_n; ++i) {
+        part = &tree->parts[n->tmpl + i];
+        len += part->lit_len + 
+            (part->var ? tree->vars[_var_resolve(tree, idx, part->var)].len : 0);
+    }
+    if (_grow((void **) &st->tmpl_buf, &st->tmpl_size, len + 1, 1)) {
+        return -1;
+    }
+    st->tmpl_len = 0;
+    for (i = 0; i < n->tmpl_n; ++i) {
+        part = &tree->parts[n->tmpl + i];
+        memcpy(st->tmpl_buf + st->tmpl_len, NODE_STR(tree, part->lit), part->lit_len);
+        st->tmpl_len += part->lit_len;
+        if (part->var) {
+            var = &tree->vars[_var_resolve(tree, idx, part->var)];
+            if (var->len) memcpy(st->tmpl_buf + st->tmpl_len, var->buf, var->len);
+            st->tmpl_len += var->len;
+        }
+    }
+    return 0;
+}
+
+static rc_t 
+processActionWrite(bt_tree_t *tree, unsigned int idx) 
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_FAILURE;
+    const char *node_id = NODE_STR(tree, n->id);
+    const char *stream_id = NODE_STR(tree, n->stream_id);
+    const char *action_value = NODE_STR(tree, n->value);
+    size_t value_len = n->value_len;
+    bt_state_t *st = &tree->state[idx];
+    fp_table_t *fp_table_item = NULL;
+    ssize_t wn = 0;
+    long long t0 = 0;
+
+    if (strlen(stream_id) == 0) {
+        ullog_err("cannot read node stream id");
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+
+    if (st->rc != RC_RUNNING) {
+        if (n->value_len > 0) {
+            st->written_bytes = 0;
+            if (n->tmpl_n && _tmpl_expand(tree, idx)) {
+                ullog_err("cannot expand template of node id '%s'", node_id);
+                task_rc = RC_ERROR;
+                goto bail;
+            }
+            if (n->tmpl_n) {
+                btlog(LOG_TMPL, idx, st->tmpl_len, 0, 0);
+            }
+        } else {
+            ullog_err("cannot read command value or it is empty");
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+    }
+
+    if(!fp_table_item) {
+        fp_table_item = _stream_get(tree, n);
+    }
+    if(!fp_table_item) {
+        btlog(LOG_STREAM_NONE, idx, n->stream, 0, 0);
+        ullog_err("cannot find open stream id for node id '%s'", node_id);
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+    if(fp_table_item->fd < 1) {
+        ullog_err("stream id is not opened for node id '%s'", node_id);
+        task_rc = RC_FAILURE;
+        goto bail;
+    }
+    btlog(LOG_STREAM, idx, n->stream, fp_table_item->fd, fp_table_item->read_bytes);
+
+    // start do actual action
+    // payload escapes are decoded at load, resume from last written byte
+    if (n->tmpl_n) {
+        action_value = st->tmpl_buf;
+        value_len = st->tmpl_len;
+    }
+    t0 = g_stats ? _now_ns() : 0;
+    wn = async_write(fp_table_item->fd, action_value + st->written_bytes, 
+        value_len - st->written_bytes);
+    if (g_stats) tree->stats.write_ns += _now_ns() - t0;
+    if (wn < 0) {
+        btlog(LOG_WRITE_ERR, idx, st->written_bytes, value_len, errno);
+        ullog_err("async_write: error writing buffer: %s", strerror(errno));
+        st->written_bytes = 0;
+        task_rc = RC_FAILURE;
+        goto bail;
+    }
+    st->written_bytes += wn;
+    tree->stats.write_bytes += wn;
+    btlog(LOG_WRITE, idx, st->written_bytes, value_len, 0);
+    if (st->written_bytes >= value_len) {
+        st->written_bytes = 0;
+        task_rc = RC_SUCCESS;
+    } else {
+        task_rc = RC_RUNNING;
+        if (nodeWaitIo(tree, idx, fp_table_item->fd, IO_WRITE)) {
+            task_rc = RC_ERROR;
+        }
+    }
+    // finish do actual action
+
+    bail:
+    return task_rc;
+}
+
+/**
+ * \brief   match pattern of node against blackboard variable, 
+ *  value is scanned in place
+ * \return:
+ *  RC_SUCCESS - pattern matched
+ *  RC_FAILURE - pattern not matched or variable is not set
+ *  RC_ERROR - node has no variable
+ */
+static rc_t
+processActionMatch(bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_FAILURE;
+    bb_var_t *var = NULL;
+    unsigned int slot = 0;
+    size_t end = 0;
+    long long t0 = 0;
+
+    if (!n->var || !n->value_len) {
+        ullog_err("match needs data variable and pattern");
+        task_rc = RC_ERROR;
+        goto bail;
+    }
+    slot = _var_resolve(tree, idx, n->var);
+    var = &tree->vars[slot];
+    if (var->kind == VAR_UNSET) {
+        btlog(LOG_VAR_UNSET, idx, slot, 0, 0);
+        task_rc = RC_FAILURE;
+        goto bail;
+    }
+
+    tree->stats.expect_bytes += var->len;
+    t0 = g_stats || tree->trace ? _now_ns() : 0;
+    var->ms.scanned = 0;
+    if (_match_scan(tree, &tree->matchers[n->matcher], var->buf, var->len, 
+                &var->ms, &end)) {
+        btlog(LOG_EXPECT_MATCH, idx, end, 0, 0);
+        task_rc = RC_SUCCESS;
+    }
+    if (g_stats) tree->stats.expect_ns += _now_ns() - t0;
+    if (tree->trace) _trace_span(tree, TRACE_MATCH, idx, t0, task_rc);
+
+    bail:
+    return task_rc;
+}
+
+/**
+ * \brief   wait for peer of stream after open or write by settle policy
+ *  of node, first run starts settling
+ * \return:
+ *  RC_SUCCESS - peer settled or settle time passed
+ *  RC_RUNNING - keep waiting
+ *  RC_ERROR - cannot wait for stream
+ */
+static rc_t
+processActionSettle(bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    rc_t task_rc = RC_RUNNING;
+    bt_state_t *st = &tree->state[idx];
+    fp_table_t *fp_table_item = NULL;
+    int pending = 0;
+    int started = st->settling;
+
+    fp_table_item = _stream_get(tree, n);
+    if (n->settle == SETTLE_NONE || !fp_table_item || fp_table_item->fd < 1) {
+        task_rc = RC_SUCCESS;
+        goto bail;
+    }
+    st->settling = 1;
+    if (started && st->deadline && st->deadline <= _now_ms() && 
+            n->settle != SETTLE_QUIET) {
+        task_rc = RC_SUCCESS;
+        goto bail;
+    }
+
+    switch (n->settle) {
+    case SETTLE_OUTPUT:
+    case SETTLE_WRITABLE:
+        if (started) {
+            task_rc = RC_SUCCESS;
+            goto bail;
+        }
+        if (nodeWaitIo(tree, idx, fp_table_item->fd, 
+                    n->settle == SETTLE_OUTPUT ? IO_READ : IO_WRITE)) {
+            task_rc = RC_ERROR;
+        }
+        break;
+    case SETTLE_QUIET:
+        // pty stays readable until expect reads it, 
+        // so wait for fd only while nothing is pending
+        if (ioctl(fp_table_item->fd, FIONREAD, &pending) < 0) {
+            pending = 0;
+        }
+        btlog(LOG_SETTLE, idx, pending, st->settle_bytes, 0);
+        if (started && pending == st->settle_bytes) {
+            if (st->deadline <= _now_ms()) {
+                task_rc = RC_SUCCESS;
+            }
+            goto bail;
+        }
+        nodeWaitDone(tree, idx);
+        st->settle_bytes = pending;
+        if (!pending && nodeWaitIo(tree, idx, fp_table_item->fd, IO_READ)) {
+            task_rc = RC_ERROR;
+            goto bail;
+        }
+        break;
+    default:
+        break;
+    }
+    if (!st->deadline || n->settle == SETTLE_QUIET) {
+        if (nodeWaitTimer(tree, idx, n->settle_ms)) {
+            task_rc = RC_ERROR;
+        }
+    }
+
+    bail:
+    if (task_rc != RC_RUNNING) {
+        st->settling = 0;
+        st->settle_bytes = 0;
+    }
+    return task_rc;
+}
+
+static rc_t
+processActionLeaf(bt_tree_t *tree, unsigned int idx)
+{
+    rc_t task_rc = RC_FAILURE;
+    bt_state_t *st = &tree->state[idx];
+
+    // finished actions keep their result
+    task_rc = st->rc;
+    if (task_rc == RC_SUCCESS || task_rc == RC_FAILURE) {
+        goto bail;
+    }
+    // waiting actions run only when their fd is ready or deadline passed
+    if (task_rc == RC_RUNNING && (st->io_fd >= 0 || st->deadline) && !st->ready) {
+        goto bail;
+    }
+    st->ready = 0;
+
+    if (st->settling) {
+        task_rc = processActionSettle(tree, idx);
+        goto done;
+    }
+
+    switch (NODE(tree, idx)->action) {
+    case ACTION_EXEC:
+        task_rc = processActionExec(tree, idx);
+        break;
+    case ACTION_OPEN:
+        task_rc = processActionOpen(tree, idx);
+        break;
+    case ACTION_CLOSE:
+        task_rc = processActionClose(tree, idx);
+        break;
+    case ACTION_EXPECT:
+        task_rc = processActionExpect(tree, idx);
+        break;
+    case ACTION_WRITE:
+        task_rc = processActionWrite(tree, idx);
+        break;
+    case ACTION_MATCH:
+        task_rc = processActionMatch(tree, idx);
+        break;
+    default:
+        // action without body
+        task_rc = RC_FAILURE;
+        break;
+    }
+    // stream actions succeed when peer settles
+    if (task_rc == RC_SUCCESS && (NODE(tree, idx)->action == ACTION_OPEN || 
+                NODE(tree, idx)->action == ACTION_WRITE)) {
+        nodeWaitDone(tree, idx);
+        task_rc = processActionSettle(tree, idx);
+    }
+
+    done:
+    if (task_rc != RC_RUNNING) {
+        nodeWaitDone(tree, idx);
+    } else if (st->io_fd < 0 && !st->deadline) {
+        tree->reactor.busy = 1;
+    }
+
+    bail:
+    return task_rc;
+}
+
+static rc_t 
+processDecoratorSucceederNode(bt_tree_t *tree, unsigned int idx)
+{
+    rc_t task_rc = RC_SUCCESS;
+    const bt_node_t *n = NODE(tree, idx);
+
+    // only first child is decorated
+    if (n->child_count > 0) {
+        task_rc = processNode(tree, KID(tree, idx, n, 0));
+        if (task_rc == RC_FAILURE) {
+            task_rc = RC_SUCCESS;
+        }
+    }
+    return task_rc;
+}
+
+/**
+ * \brief   run child of timeout decorator, processNode halts it 
+ *  and fails when timeout_ms of decorator passes
+ * \return:
+ *  result of child
+ */
+static rc_t
+processDecoratorTimeoutNode(bt_tree_t *tree, unsigned int idx)
+{
+    rc_t task_rc = RC_SUCCESS;
+    const bt_node_t *n = NODE(tree, idx);
+
+    // only first child is decorated
+    if (n->child_count > 0) {
+        task_rc = processNode(tree, KID(tree, idx, n, 0));
+    }
+    return task_rc;
+}
+
+/**
+ * \brief   run child of retry or repeat decorator again while it ends 
+ *  with again_rc, count runs at most, next run is parked on timer of 
+ *  decorator for backoff_ms, which doubles after each run
+ * \return:
+ *  result of last run of child
+ */
+static rc_t
+processDecoratorLoopNode(bt_tree_t *tree, unsigned int idx, rc_t again_rc)
+{
+    rc_t task_rc = RC_SUCCESS;
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int kid = 0;
+    unsigned int shift = 0;
+
+    // only first child is decorated
+    if (n->child_count == 0) {
+        goto bail;
+    }
+    kid = KID(tree, idx, n, 0);
+    if (st->rc != RC_RUNNING) {
+        st->cursor = 0;
+    } else if (st->deadline) {
+        // child does not run until backoff passes
+        if (!st->ready) {
+            task_rc = RC_RUNNING;
+            goto bail;
+        }
+        nodeWaitDone(tree, idx);
+    }
+    task_rc = processNode(tree, kid);
+    if (task_rc != again_rc) {
+        goto bail;
+    }
+    ++st->cursor;
+    if (n->count && st->cursor >= n->count) {
+        goto bail;
+    }
+    btlog(LOG_NODE_AGAIN, idx, st->cursor, task_rc, 0);
+    nodeReset(tree, kid);
+    task_rc = RC_RUNNING;
+    if (n->backoff_ms) {
+        shift = st->cursor - 1 < LOOP_BACKOFF_SHIFT_MAX ? 
+            st->cursor - 1 : LOOP_BACKOFF_SHIFT_MAX;
+        if (nodeWaitTimer(tree, idx, (long long) n->backoff_ms << shift)) {
+            task_rc = RC_ERROR;
+        }
+    } else {
+        tree->reactor.busy = 1;
+    }
+
+    bail:
+    return task_rc;
+}
+
+/**
+ * \brief   run fragment of subtree node, params of node are assigned 
+ *  to own variable slots of this use when subtree starts
+ * \return:
+ *  result of fragment
+ */
+static rc_t
+processSubtreeNode(bt_tree_t *tree, unsigned int idx)
+{
+    rc_t task_rc = RC_SUCCESS;
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    const tmpl_part_t *part = NULL;
+    unsigned int i = 0;
+
+    if (st->rc != RC_RUNNING) {
+        for (i = 0; i < n->tmpl_n; ++i) {
+            part = &tree->parts[n->tmpl + i];
+            if (_var_set(tree, st->frame + i, NODE_STR(tree, part->lit), part->lit_len)) {
+                ullog_err("cannot set subtree param");
+                task_rc = RC_ERROR;
+                goto bail;
+            }
+        }
+    }
+    if (n->child_count > 0) {
+        task_rc = processNode(tree, KID(tree, idx, n, 0));
+    }
+
+    bail:
+    return task_rc;
+}
+
+static rc_t 
+processSequenceNode(bt_tree_t *tree, unsigned int idx)
+{
+    rc_t task_rc = RC_SUCCESS;
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+
+    // resume from running child, children before it succeeded
+    i = (st->rc == RC_RUNNING) ? st->cursor : 0;
+    for (; i < n->child_count; ++i) {
+        task_rc = processNode(tree, KID(tree, idx, n, i));
+        if (task_rc == RC_RUNNING) {
+            st->cursor = i;
+            goto bail;
+        }
+        if (task_rc == RC_FAILURE || task_rc == RC_ERROR) {
+            goto bail;
+        }
+    }
+
+    bail:
+    return task_rc;
+}
+
+static rc_t 
+processSelectNode(bt_tree_t *tree, unsigned int idx) 
+{
+    rc_t task_rc = RC_SUCCESS;
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+
+    // resume from running child, children before it failed
+    i = (st->rc == RC_RUNNING) ? st->cursor : 0;
+    for (; i < n->child_count; ++i) {
+        task_rc = processNode(tree, KID(tree, idx, n, i));
+        if (task_rc == RC_RUNNING) {
+            st->cursor = i;
+            goto bail;
+        }
+        if (task_rc == RC_SUCCESS || task_rc == RC_ERROR) {
+            goto bail;
+        }
+    }
+
+    bail:
+    return task_rc;
+}
+
+/**
+ * \brief   stop running node and its running children, 
+ *  halted nodes run from start when ticked again
+ */
+static void
+nodeHalt(bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+
+    if (st->rc != RC_RUNNING) {
+        return;
+    }
+    btlog(LOG_NODE_HALT, idx, 0, 0, 0);
+    for (i = 0; i < n->child_count; ++i) {
+        nodeHalt(tree, KID(tree, idx, n, i));
+    }
+    nodeWaitDone(tree, idx);
+    _timer_cancel(tree, TIMER_ID(idx, TIMER_TIMEOUT));
+    if (st->pid > 0) {
+        _exec_reap(st, SIGKILL);
+    }
+    st->written_bytes = 0;
+    st->cursor = 0;
+    st->settling = 0;
+    st->settle_bytes = 0;
+    st->rc = RC_UNKNOWN;
+}
+
+/**
+ * \brief   forget results of finished node and its children, 
+ *  so they run from start when ticked again
+ */
+static void
+nodeReset(bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+
+    if (st->rc == RC_RUNNING) {
+        nodeHalt(tree, idx);
+    }
+    // halted node keeps finished children
+    for (i = 0; i < n->child_count; ++i) {
+        nodeReset(tree, KID(tree, idx, n, i));
+    }
+    st->cursor = 0;
+    st->restored = 0;
+    st->rc = RC_UNKNOWN;
+}
+
+static rc_t 
+processParallelNode(bt_tree_t *tree, unsigned int idx) 
+{
+    rc_t task_rc = RC_RUNNING;
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+    unsigned int i = 0;
+    unsigned int kid = 0;
+    unsigned int succeeded = 0;
+    unsigned int failed = 0;
+    unsigned int running = 0;
+    rc_t kid_rc = RC_UNKNOWN;
+
+    // resolved parallel keeps its result, halted children must not restart
+    if (st->rc == RC_SUCCESS || st->rc == RC_FAILURE) {
+        task_rc = st->rc;
+        goto bail;
+    }
+
+    // all unfinished children make progress in the same tick
+    for (i = 0; i < n->child_count; ++i) {
+        kid = KID(tree, idx, n, i);
+        kid_rc = tree->state[kid].rc;
+        if (kid_rc != RC_SUCCESS && kid_rc != RC_FAILURE) {
+            kid_rc = processNode(tree, kid);
+        }
+        if (kid_rc == RC_ERROR) {
+            task_rc = RC_ERROR;
+            goto halt;
+        }
+        if (kid_rc == RC_SUCCESS) {
+            ++succeeded;
+        } else if (kid_rc == RC_FAILURE) {
+            ++failed;
+        } else {
+            ++running;
+        }
+    }
+    btlog(LOG_PARALLEL, idx, succeeded, failed, running);
+
+    if (succeeded >= n->success_threshold) {
+        task_rc = RC_SUCCESS;
+    } else if (failed >= n->failure_threshold || 
+            succeeded + running < n->success_threshold) {
+        task_rc = RC_FAILURE;
+    }
+
+    halt:
+    if (task_rc != RC_RUNNING) {
+        for (i = 0; i < n->child_count; ++i) {
+            nodeHalt(tree, KID(tree, idx, n, i));
+        }
+    }
+
+    bail:
+    return task_rc;
+}
+
+static rc_t 
+processNode(bt_tree_t *tree, unsigned int idx) 
+{
+    rc_t task_rc = RC_SUCCESS;
+    long long t0 = tree->trace ? _now_ns() : 0;
+    const bt_node_t *n = NODE(tree, idx);
+    bt_state_t *st = &tree->state[idx];
+
+    btlog(LOG_NODE_ENTER, idx, st->rc, 0, 0);
+    if (st->restored) {
+        // succeeded before restart
+        task_rc = st->rc;
+        goto done;
+    }
+    if (n->timeout_ms) {
+        if (st->rc != RC_RUNNING) {
+            st->timed_out = 0;
+            _timer_arm(tree, TIMER_ID(idx, TIMER_TIMEOUT), _now_ms() + n->timeout_ms);
+        } else if (st->timed_out) {
+            // running subtree is stopped and fails
+            btlog(LOG_NODE_TIMEOUT, idx, n->timeout_ms, 0, 0);
+            nodeHalt(tree, idx);
+            task_rc = RC_FAILURE;
+            goto done;
+        }
+    }
+    switch (n->kind) {
+    case NODE_ACTION:
+        task_rc = processActionLeaf(tree, idx);
+        break;
+    case NODE_ROOT:
+    case NODE_SEQUENCE:
+        task_rc = processSequenceNode(tree, idx);
+        break;
+    case NODE_SELECT:
+        task_rc = processSelectNode(tree, idx);
+        break;
+    case NODE_PARALLEL:
+        task_rc = processParallelNode(tree, idx);
+        break;
+    case NODE_DECORATOR_SUCCEEDER:
+        task_rc = processDecoratorSucceederNode(tree, idx);
+        break;
+    case NODE_SUBTREE:
+        task_rc = processSubtreeNode(tree, idx);
+        break;
+    case NODE_DECORATOR_TIMEOUT:
+        task_rc = processDecoratorTimeoutNode(tree, idx);
+        break;
+    case NODE_DECORATOR_RETRY:
+        task_rc = processDecoratorLoopNode(tree, idx, RC_FAILURE);
+        break;
+    case NODE_DECORATOR_REPEAT:
+        task_rc = processDecoratorLoopNode(tree, idx, RC_SUCCESS);
+        break;
+    default:
+        ullog_err("node kind %d is not supported", n->kind);
+        task_rc = RC_ERROR;
+        break;
+    }
+
+    done:
+    btlog(LOG_NODE_EXIT, idx, task_rc, 0, 0);
+    nodeSetState(tree, idx, task_rc);
+    ++tree->stats.dispatches;
+    if (tree->trace) _trace_span(tree, TRACE_NODE, idx, t0, task_rc);
+
+    return task_rc;
+}
+
+static rc_t 
+processRootNode(bt_tree_t *tree) 
+{
+    rc_t task_rc = RC_SUCCESS;
+
+    // root is processed as sequence
+    task_rc = processNode(tree, 0);
+
+    return task_rc;
+}
+
+/**
+ * \brief   append string to tree string pool
+ * \return:
+ *  offset of string in pool, 0 if string is empty or on error
+ */
+static unsigned int
+_pool_add(bt_tree_t *tree, const char *str, size_t len)
+{
+    unsigned int off = 0;
+
+    if (!str || !len) {
+        return 0;
+    }
+    if (_grow((void **) &tree->strs, &tree->strs_size, 
+                tree->strs_n + len + 1, sizeof(char))) {
+        return 0;
+    }
+    off = (unsigned int) tree->strs_n;
+    memcpy(tree->strs + off, str, len);
+    tree->strs[off + len] = '\0';
+    tree->strs_n += len + 1;
+    return off;
+}
+
+/**
+ * \brief   intern string in tree string pool, equal strings share offset
+ * \return:
+ *  offset of string in pool, 0 if string is empty or on error
+ */
+static unsigned int
+_pool_intern(bt_tree_t *tree, const char *str)
+{
+    intern_t *item = NULL;
+    size_t len = str ? strlen(str) : 0;
+
+    if (!len) {
+        return 0;
+    }
+    HASH_FIND(hh, tree->intern, str, len, item);
+    if (item) {
+        return item->off;
+    }
+    // intern table lives in scratch arena until end of compile
+    if ((item = _arena_alloc(&tree->scratch, sizeof(intern_t))) == NULL || 
+            (item->key = _arena_strndup(&tree->scratch, str, len)) == NULL || 
+            (item->off = _pool_add(tree, str, len)) == 0) {
+        return 0;
+    }
+    HASH_ADD_KEYPTR(hh, tree->intern, item->key, len, item);
+    return item->off;
+}
+
+/**
+ * \brief   note stat of file read by compile, image written from tree 
+ *  is stale once any of them changes
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_src_add(bt_tree_t *tree, const char *path)
+{
+    struct stat st;
+    bteb_src_t *item = NULL;
+    unsigned int off = 0;
+    unsigned int i = 0;
+
+    if ((off = _pool_intern(tree, path)) == 0) {
+        ullog_err("cannot store source path");
+        return -1;
+    }
+    for (i = 0; i < tree->srcs_n; ++i) {
+        if (tree->srcs[i].path == off) {
+            return 0;
+        }
+    }
+    if (stat(path, &st)) {
+        ullog_err("unable to open file %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (_grow((void **) &tree->srcs, &tree->srcs_size, 
+                tree->srcs_n + 1, sizeof(bteb_src_t))) {
+        ullog_err("cannot store source path");
+        return -1;
+    }
+    item = &tree->srcs[tree->srcs_n++];
+    memset(item, 0, sizeof(bteb_src_t));
+    item->mtime = st.st_mtime;
+    item->size = st.st_size;
+    item->path = off;
+    return 0;
+}
+
+/**
+ * \brief   intern stream id of action and give it stream slot, 
+ *  actions naming same stream share slot
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_stream_intern(bt_tree_t *tree, xmlTextReaderPtr reader, bt_node_t *n)
+{
+    xmlChar *prop = NULL;
+    intern_t *item = NULL;
+    int rc = 0;
+
+    prop = xmlTextReaderGetAttribute(reader, (const xmlChar *) "stream_id");
+    if (!prop || !*prop) {
+        goto bail;
+    }
+    if ((n->stream_id = _pool_intern(tree, (const char *) prop)) == 0) {
+        rc = -1;
+        goto bail;
+    }
+    HASH_FIND(hh, tree->intern, prop, strlen((const char *) prop), item);
+    if (!item) {
+        rc = -1;
+        goto bail;
+    }
+    if (!item->slot) {
+        item->slot = ++tree->streams_n;
+    }
+    n->stream = item->slot;
+
+    bail:
+    if (prop) xmlFree(prop);
+    return rc;
+}
+
+/**
+ * \brief   intern variable name and give it blackboard slot, 
+ *  nodes naming same variable share slot
+ * \return:
+ *  slot of variable, 0 on error
+ */
+static unsigned int
+_var_slot(bt_tree_t *tree, const char *name)
+{
+    intern_t *item = NULL;
+
+    if (!_pool_intern(tree, name)) {
+        return 0;
+    }
+    HASH_FIND(hh, tree->intern, name, strlen(name), item);
+    if (!item) {
+        return 0;
+    }
+    if (!item->var) {
+        item->var = ++tree->vars_n;
+    }
+    return item->var;
+}
+
+/**
+ * \brief   note variable captured by fragment being compiled, 
+ *  each use of subtree gets own slot for it
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_var_local(bt_tree_t *tree, unsigned int slot)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < tree->locals_n; ++i) {
+        if (tree->locals[i] == slot) {
+            return 0;
+        }
+    }
+    if (_grow((void **) &tree->locals, &tree->locals_size, 
+                tree->locals_n + 1, sizeof(unsigned int))) {
+        return -1;
+    }
+    tree->locals[tree->locals_n++] = slot;
+    return 0;
+}
+
+/**
+ * \brief   read variable of action from data attribute, 
+ *  exec and expect capture into it, match reads it
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_var_parse(bt_tree_t *tree, xmlTextReaderPtr reader, bt_node_t *n)
+{
+    xmlChar *prop = NULL;
+    int rc = 0;
+
+    prop = xmlTextReaderGetAttribute(reader, (const xmlChar *) "data");
+    if (!prop || !*prop) {
+        if (n->action == ACTION_MATCH) {
+            ullog_err("match needs data attribute");
+            rc = -1;
+        }
+        goto bail;
+    }
+    if (n->action != ACTION_EXEC && n->action != ACTION_EXPECT && 
+            n->action != ACTION_MATCH) {
+        ullog_err("data attribute is not supported by action");
+        rc = -1;
+        goto bail;
+    }
+    if ((n->var = _var_slot(tree, (const char *) prop)) == 0 || 
+            (tree->compile_depth && n->action != ACTION_MATCH && 
+             _var_local(tree, n->var))) {
+        ullog_err("cannot store variable '%s'", prop);
+        rc = -1;
+        goto bail;
+    }
+
+    bail:
+    if (prop) xmlFree(prop);
+    return rc;
+}
+
+/**
+ * \brief   split write payload at ${name} references into template parts, 
+ *  payload without references stays plain
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_tmpl_compile(bt_tree_t *tree, bt_node_t *n, const char *value, size_t len)
+{
+    const char *p = value;
+    const char *end = value + len;
+    const char *ref = NULL;
+    const char *close = NULL;
+    char *name = NULL;
+    tmpl_part_t *part = NULL;
+
+    if (!memmem(value, len, "${", 2)) {
+        return 0;
+    }
+    n->tmpl = tree->parts_n;
+    while (p < end) {
+        if (_grow((void **) &tree->parts, &tree->parts_size, 
+                    tree->parts_n + 1, sizeof(tmpl_part_t))) {
+            ullog_err("cannot allocate write template");
+            return -1;
+        }
+        part = &tree->parts[tree->parts_n++];
+        memset(part, 0, sizeof(tmpl_part_t));
+        ++n->tmpl_n;
+        ref = memmem(p, end - p, "${", 2);
+        part->lit_len = (ref ? ref : end) - p;
+        if (part->lit_len && (part->lit = _pool_add(tree, p, part->lit_len)) == 0) {
+            ullog_err("cannot store write template");
+            return -1;
+        }
+        if (!ref) {
+            break;
+        }
+        if ((close = memchr(ref + 2, '}', end - ref - 2)) == NULL || close == ref + 2) {
+            ullog_err("bad variable reference in write at line %u", n->line);
+            return -1;
+        }
+        // name lives in scratch arena until end of compile
+        if ((name = _arena_strndup(&tree->scratch, ref + 2, close - ref - 2)) == NULL || 
+                (part->var = _var_slot(tree, name)) == 0) {
+            ullog_err("cannot store variable of write template");
+            return -1;
+        }
+        p = close + 1;
+    }
+    return 0;
+}
+
+static unsigned int
+_prop_intern(bt_tree_t *tree, xmlTextReaderPtr reader, const char *name)
+{
+    xmlChar *prop = NULL;
+    unsigned int off = 0;
+
+    prop = xmlTextReaderGetAttribute(reader, (const xmlChar *) name);
+    if (prop) {
+        off = _pool_intern(tree, (const char *) prop);
+        xmlFree(prop);
+    }
+    return off;
+}
+
+/**
+ * \brief   read unsigned integer attribute, val is kept if there is none
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_prop_uint(xmlTextReaderPtr reader, const char *name, unsigned int *val)
+{
+    int rc = 0;
+    xmlChar *prop = NULL;
+    char *end = NULL;
+    long v = 0;
+
+    if ((prop = xmlTextReaderGetAttribute(reader, (const xmlChar *) name)) == NULL) {
+        goto bail;
+    }
+    errno = 0;
+    v = strtol((const char *) prop, &end, 10);
+    if (errno || end == (char *) prop || *end || v < 0 || v > INT_MAX) {
+        ullog_err("%s '%s' is not valid", name, prop);
+        rc = -1;
+        goto bail;
+    }
+    *val = v;
+
+    bail:
+    if (prop) xmlFree(prop);
+    return rc;
+}
+
+/**
+ * \brief   compile glob pattern of expect node, 
+ *  patterns without glob chars are searched as substrings
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_match_compile(bt_tree_t *tree, bt_node_t *n, const char *pattern)
+{
+    int rc = 0;
+    matcher_t *m = NULL;
+    size_t len = strlen(pattern);
+    size_t i = 0;
+    int lo = 0;
+    int hi = 0;
+    int c = 0;
+    glob_tok_t *tok = NULL;
+    char *lit = NULL;
+
+    if (_grow((void **) &tree->matchers, &tree->matchers_size, 
+                tree->matchers_n + 1, sizeof(matcher_t)) || 
+            _grow((void **) &tree->toks, &tree->toks_size, 
+                tree->toks_n + len + 1, sizeof(glob_tok_t))) {
+        ullog_err("cannot allocate expect pattern");
+        return -1;
+    }
+    n->matcher = tree->matchers_n++;
+    m = &tree->matchers[n->matcher];
+    memset(m, 0, sizeof(matcher_t));
+    m->toks = tree->toks_n;
+
+    // anchors and surrounding stars are flags, unanchored glob is a search
+    if (len && pattern[0] == '^') {
+        m->flags |= MATCH_ANCHOR_START;
+        ++pattern;
+        --len;
+    }
+    if (len && pattern[len - 1] == '$' && (len < 2 || pattern[len - 2] != '\\')) {
+        m->flags |= MATCH_ANCHOR_END;
+        --len;
+    }
+    while (len && pattern[0] == '*') {
+        m->flags &= ~MATCH_ANCHOR_START;
+        ++pattern;
+        --len;
+    }
+    while (len && pattern[len - 1] == '*' && (len < 2 || pattern[len - 2] != '\\')) {
+        m->flags &= ~MATCH_ANCHOR_END;
+        m->flags |= MATCH_CONSUME_ALL;
+        --len;
+    }
+
+    memset(MATCH_TOK(tree, m, 0), 0, (len + 1) * sizeof(glob_tok_t));
+    if ((lit = _arena_alloc(&tree->scratch, len + 1)) == NULL) {
+        ullog_err("cannot allocate expect pattern");
+        rc = -1;
+        goto bail;
+    }
+    m->kind = MATCH_LITERAL;
+    for (i = 0; i < len; ++i) {
+        tok = MATCH_TOK(tree, m, m->toks_n++);
+        switch (pattern[i]) {
+        case '*':
+            tok->kind = GLOB_STAR;
+            m->kind = MATCH_GLOB;
+            break;
+        case '?':
+            tok->kind = GLOB_ANY;
+            m->kind = MATCH_GLOB;
+            break;
+        case '[':
+            tok->kind = GLOB_CLASS;
+            m->kind = MATCH_GLOB;
+            for (++i; i < len && pattern[i] != ']'; ++i) {
+                if (pattern[i] == '\\' && i + 1 < len) {
+                    ++i;
+                }
+                lo = hi = (unsigned char) pattern[i];
+                if (i + 2 < len && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+                    hi = (unsigned char) pattern[i + 2];
+                    i += 2;
+                }
+                for (c = lo; c <= hi; ++c) {
+                    tok->set[c / 8] |= 1 << (c % 8);
+                }
+            }
+            if (i == len) {
+                ullog_err("expect pattern '%s' has unterminated class", pattern);
+                rc = -1;
+                goto bail;
+            }
+            break;
+        case '\\':
+            if (i + 1 < len) {
+                ++i;
+            }
+            // fall through
+        default:
+            tok->kind = GLOB_CHAR;
+            tok->c = pattern[i];
+            lit[m->toks_n - 1] = pattern[i];
+            break;
+        }
+    }
+    if (m->kind == MATCH_LITERAL && 
+            !(m->flags & (MATCH_ANCHOR_START | MATCH_ANCHOR_END)) && m->toks_n) {
+        m->lit_len = m->toks_n;
+        m->lit = _pool_add(tree, lit, m->lit_len);
+        if (!m->lit) {
+            ullog_err("cannot store expect pattern");
+            rc = -1;
+            goto bail;
+        }
+    } else {
+        m->kind = MATCH_GLOB;
+    }
+    tree->toks_n += m->toks_n;
+    ullog_debug("expect pattern kind %d flags %d tokens %u", 
+            m->kind, m->flags, m->toks_n);
+
+    bail:
+    return rc;
+}
+
+/**
+ * \brief   read settle policy of action from settle and settle_ms attributes
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_settle_parse(bt_node_t *n, xmlTextReaderPtr reader)
+{
+    int rc = 0;
+    xmlChar *settle = NULL;
+    int i = 0;
+
+    n->settle = SETTLE_DELAY;
+    n->settle_ms = SETTLE_MS_DEFAULT;
+    if ((settle = xmlTextReaderGetAttribute(reader, (const xmlChar *) "settle")) != NULL) {
+        for (i = 0; settles_str_mapping[i].str; ++i) {
+            if (!xmlStrcmp(settle, (const xmlChar *) settles_str_mapping[i].str)) {
+                break;
+            }
+        }
+        if (!settles_str_mapping[i].str) {
+            ullog_err("settle '%s' is not supported", settle);
+            rc = -1;
+            goto bail;
+        }
+        n->settle = settles_str_mapping[i].code;
+    }
+    if (_prop_uint(reader, "settle_ms", &n->settle_ms)) {
+        rc = -1;
+        goto bail;
+    }
+
+    bail:
+    if (settle) xmlFree(settle);
+    return rc;
+}
+
+/**
+ * \brief   append text of node reader is positioned at to buffer
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_text_append(xmlTextReaderPtr reader, char **buf, size_t *len, size_t *size)
+{
+    const xmlChar *text = xmlTextReaderConstValue(reader);
+    size_t n = text ? strlen((const char *) text) : 0;
+
+    if (_grow((void **) buf, size, *len + n + 1, sizeof(char))) {
+        return -1;
+    }
+    if (n) memcpy(*buf + *len, text, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+    return 0;
+}
+
+/**
+ * \brief   compile action element reader is positioned at, 
+ *  reader is left at end of action
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+compileAction(bt_tree_t *tree, unsigned int idx, xmlTextReaderPtr reader)
+{
+    ullog_debug("enter");
+
+    int rc = 0;
+    int ret = 1;
+    int depth = xmlTextReaderDepth(reader);
+    int empty = xmlTextReaderIsEmptyElement(reader);
+    int type = 0;
+    int body = 0; // first element of action is read
+    const xmlChar *name = NULL;
+    char *action_value = NULL;
+    size_t value_n = 0;
+    size_t value_size = 0;
+    char id_buf[16] = "";
+    bt_node_t *n = NODE(tree, idx);
+
+    // first element defines action, its text is action value
+    while (!empty && (ret = xmlTextReaderRead(reader)) == 1) {
+        type = xmlTextReaderNodeType(reader);
+        if (type == XML_READER_TYPE_END_ELEMENT && 
+                xmlTextReaderDepth(reader) == depth) {
+            break;
+        }
+        if (body) {
+            if (body == 1 && xmlTextReaderDepth(reader) > depth + 1 && 
+                    (type == XML_READER_TYPE_TEXT || 
+                     type == XML_READER_TYPE_CDATA || 
+                     type == XML_READER_TYPE_WHITESPACE || 
+                     type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) && 
+                    _text_append(reader, &action_value, &value_n, &value_size)) {
+                ullog_err("cannot allocate action value");
+                rc = -1;
+                goto bail;
+            }
+            if (xmlTextReaderDepth(reader) == depth + 1 && 
+                    (type == XML_READER_TYPE_END_ELEMENT || 
+                     xmlTextReaderIsEmptyElement(reader))) {
+                body = 2;
+            }
+            continue;
+        }
+        if (type != XML_READER_TYPE_ELEMENT) {
+            continue;
+        }
+        name = xmlTextReaderConstName(reader);
+        if (xmlStrcmp(name, (const xmlChar *) "exec") == 0) {
+            n->action = ACTION_EXEC;
+        } else if (xmlStrcmp(name, (const xmlChar *) "open") == 0) {
+            n->action = ACTION_OPEN;
+        } else if (xmlStrcmp(name, (const xmlChar *) "close") == 0) {
+            n->action = ACTION_CLOSE;
+        } else if (xmlStrcmp(name, (const xmlChar *) "expect") == 0) {
+            n->action = ACTION_EXPECT;
+        } else if (xmlStrcmp(name, (const xmlChar *) "write") == 0) {
+            n->action = ACTION_WRITE;
+        } else if (xmlStrcmp(name, (const xmlChar *) "match") == 0) {
+            n->action = ACTION_MATCH;
+        } else {
+            ullog_err("node '%s' is not supported", name);
+            _xmlDump(reader);
+            rc = -1;
+            goto bail;
+        }
+        body = xmlTextReaderIsEmptyElement(reader) ? 2 : 1;
+        n->line = xmlTextReaderCurrentNode(reader)->line;
+        if (_stream_intern(tree, reader, n)) {
+            ullog_err("cannot store stream id");
+            rc = -1;
+            goto bail;
+        }
+        if (_settle_parse(n, reader) || _var_parse(tree, reader, n) || 
+                _prop_uint(reader, "cache_ttl_ms", &n->cache_ttl_ms)) {
+            _xmlDump(reader);
+            rc = -1;
+            goto bail;
+        }
+        if (!n->id) {
+            n->id = _prop_intern(tree, reader, "id");
+        }
+        if (_grow((void **) &action_value, &value_size, 1, sizeof(char))) {
+            ullog_err("cannot allocate action value");
+            rc = -1;
+            goto bail;
+        }
+        action_value[0] = '\0';
+    }
+    if (ret != 1) {
+        ullog_err("unable to read action at line %u", n->line);
+        rc = -1;
+        goto bail;
+    }
+
+    if (action_value) {
+        n->value_len = value_n;
+        if (n->action == ACTION_WRITE) {
+            n->value_len = _unescape(action_value, n->value_len);
+        }
+        n->value = _pool_add(tree, action_value, n->value_len);
+        if (n->action == ACTION_EXEC) {
+            n->shell = strpbrk(action_value, EXEC_SHELL_CHARS) != NULL;
+        } else if (n->cache_ttl_ms) {
+            ullog_err("cache_ttl_ms is supported by exec only at line %u", n->line);
+            rc = -1;
+            goto bail;
+        }
+        if ((n->action == ACTION_EXPECT || n->action == ACTION_MATCH) && 
+                _match_compile(tree, n, action_value)) {
+            printf("source line: %u\n", n->line);
+            rc = -1;
+            goto bail;
+        }
+        if (n->action == ACTION_WRITE && 
+                _tmpl_compile(tree, n, action_value, n->value_len)) {
+            rc = -1;
+            goto bail;
+        }
+        if (n->value_len && !n->value) {
+            ullog_err("cannot store action value");
+            rc = -1;
+            goto bail;
+        }
+    }
+
+    // action without id is named by its node ordinal, same on every load
+    if (!n->id) {
+        snprintf(id_buf, sizeof(id_buf), "%u", idx);
+        if ((n->id = _pool_intern(tree, id_buf)) == 0) {
+            ullog_err("cannot store node id");
+            rc = -1;
+            goto bail;
+        }
+        ullog_debug("node id from ordinal '%s'", id_buf);
+    }
+
+    bail:
+    if (action_value) free(action_value);
+
+    ullog_debug("exit");
+    return rc;
+}
+
+/**
+ * \brief   end of node range, node is followed by all its descendants
+ * \return:
+ *  index after last descendant of node
+ */
+static unsigned int
+_node_end(const bt_tree_t *tree, unsigned int idx)
+{
+    const bt_node_t *n = NULL;
+
+    while ((n = NODE(tree, idx))->child_count) {
+        idx = KID(tree, idx, n, n->child_count - 1);
+    }
+    return idx + 1;
+}
+
+/**
+ * \brief   append nodes of another use of compiled fragment at root, 
+ *  they share its definitions and only get own state
+ * \return:
+ *  0 - success, index of used root is in use
+ *  -1 - error
+ */
+static int
+_subtree_use(bt_tree_t *tree, unsigned int root, unsigned int *use)
+{
+    unsigned int end = _node_end(tree, root);
+
+    if (_grow((void **) &tree->defs, &tree->defs_size, 
+                tree->defs_n + (end - root), sizeof(unsigned int))) {
+        ullog_err("cannot allocate tree node");
+        return -1;
+    }
+    *use = tree->defs_n;
+    memcpy(tree->defs + tree->defs_n, tree->defs + root, 
+            (end - root) * sizeof(unsigned int));
+    tree->defs_n += end - root;
+    ullog_debug("used subtree %u at %u, %u nodes", root, *use, end - root);
+    return 0;
+}
+
+/**
+ * \brief   compile fragment with id from file, whole document 
+ *  if id is empty, variables it captures are kept in item
+ * \return:
+ *  0 - success, index of fragment root is in root
+ *  -1 - error
+ */
+static int
+_subtree_compile(bt_tree_t *tree, const char *path, const char *id, 
+        subtree_t *item, unsigned int *root)
+{
+    xmlTextReaderPtr reader = NULL;
+    xmlChar *prop = NULL;
+    const char *compile_src = tree->compile_src;
+    unsigned int *locals = tree->locals;
+    unsigned int locals_n = tree->locals_n;
+    size_t locals_size = tree->locals_size;
+    int found = 0;
+    int ret = 0;
+    int rc = -1;
+
+    if (_src_add(tree, path)) {
+        goto bail;
+    }
+    if ((reader = xmlReaderForFile(path, NULL, 0)) == NULL) {
+        ullog_err("unable to open file %s", path);
+        goto bail;
+    }
+    while (!found && (ret = xmlTextReaderRead(reader)) == 1) {
+        if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+            continue;
+        }
+        if (!*id) {
+            found = 1;
+            break;
+        }
+        prop = xmlTextReaderGetAttribute(reader, (const xmlChar *) "id");
+        found = prop && strcmp((const char *) prop, id) == 0;
+        if (prop) xmlFree(prop);
+    }
+    if (!found) {
+        ullog_err("cannot find subtree '%s' in %s", id, path);
+        goto bail;
+    }
+    // fragment collects own captures, nested fragments have theirs
+    tree->compile_src = path;
+    tree->locals = NULL;
+    tree->locals_n = 0;
+    tree->locals_size = 0;
+    ++tree->compile_depth;
+    rc = compileNode(tree, reader, root);
+    --tree->compile_depth;
+    tree->compile_src = compile_src;
+    if (!rc && tree->locals_n) {
+        if ((item->locals = _arena_alloc(&tree->scratch, 
+                        tree->locals_n * sizeof(unsigned int))) == NULL) {
+            ullog_err("cannot allocate subtree");
+            rc = -1;
+        } else {
+            memcpy(item->locals, tree->locals, tree->locals_n * sizeof(unsigned int));
+            item->locals_n = tree->locals_n;
+        }
+    }
+    if (tree->locals) free(tree->locals);
+    tree->locals = locals;
+    tree->locals_n = locals_n;
+    tree->locals_size = locals_size;
+
+    bail:
+    if (reader) xmlFreeTextReader(reader);
+    return rc;
+}
+
+/**
+ * \brief   compile subtree node, fragment named by ref attribute 
+ *  file#id is compiled once per tree and later uses copy its nodes, 
+ *  other attributes are params assigned to variables when subtree starts, 
+ *  params and variables captured by fragment are local to each use
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+compileSubtree(bt_tree_t *tree, unsigned int idx, xmlTextReaderPtr reader)
+{
+    ullog_debug("enter");
+
+    int rc = 0;
+    int ret = 0;
+    xmlChar *ref = NULL;
+    char *id = NULL;
+    char path[PATH_MAX] = "";
+    char real[PATH_MAX] = "";
+    const char *slash = NULL;
+    char *key = NULL;
+    size_t key_len = 0;
+    subtree_t *item = NULL;
+    tmpl_part_t *part = NULL;
+    const xmlChar *name = NULL;
+    const xmlChar *value = NULL;
+    unsigned int line = NODE(tree, idx)->line;
+    unsigned int root = 0;
+    unsigned int kid = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    if (!xmlTextReaderIsEmptyElement(reader)) {
+        ullog_err("subtree at line %u must be empty element", line);
+        rc = -1;
+        goto bail;
+    }
+    if ((ref = xmlTextReaderGetAttribute(reader, (const xmlChar *) "ref")) == NULL || 
+            !*ref) {
+        ullog_err("subtree at line %u has no ref", line);
+        rc = -1;
+        goto bail;
+    }
+
+    // file part is relative to document having the ref
+    if ((id = strchr((char *) ref, '#')) != NULL) {
+        *id++ = '\0';
+    } else {
+        id = "";
+    }
+    if (!*ref && !tree->compile_src) {
+        ullog_err("subtree ref at line %u needs file in tree without file", line);
+        rc = -1;
+        goto bail;
+    }
+    if (!*ref) {
+        snprintf(path, sizeof(path), "%s", tree->compile_src);
+    } else if (*ref == '/' || !tree->compile_src || 
+            (slash = strrchr(tree->compile_src, '/')) == NULL) {
+        snprintf(path, sizeof(path), "%s", (const char *) ref);
+    } else {
+        snprintf(path, sizeof(path), "%.*s/%s", 
+                (int) (slash - tree->compile_src), tree->compile_src, (const char *) ref);
+    }
+    if (realpath(path, real) == NULL) {
+        ullog_err("unable to open file %s: %s", path, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+
+    // compile table lives in scratch arena until end of compile
+    key_len = strlen(real) + 1 + strlen(id);
+    if ((key = _arena_alloc(&tree->scratch, key_len + 1)) == NULL) {
+        ullog_err("cannot allocate subtree");
+        rc = -1;
+        goto bail;
+    }
+    snprintf(key, key_len + 1, "%s#%s", real, id);
+    HASH_FIND(hh, tree->subtrees, key, key_len, item);
+    if (item && item->busy) {
+        ullog_err("subtree '%s' at line %u refers to itself", key, line);
+        rc = -1;
+        goto bail;
+    }
+    if (item) {
+        rc = _subtree_use(tree, item->root, &kid);
+    } else {
+        if ((item = _arena_alloc(&tree->scratch, sizeof(subtree_t))) == NULL) {
+            ullog_err("cannot allocate subtree");
+            rc = -1;
+            goto bail;
+        }
+        item->key = key;
+        item->busy = 1;
+        HASH_ADD_KEYPTR(hh, tree->subtrees, item->key, key_len, item);
+        rc = _subtree_compile(tree, real, id, item, &root);
+        item->busy = 0;
+        item->root = kid = root;
+    }
+    if (rc) {
+        printf("source line: %u\n", line);
+        goto bail;
+    }
+
+    // fragment root is only child
+    if (_grow((void **) &tree->kids, &tree->kids_size, 
+                tree->kids_n + 1, sizeof(unsigned int))) {
+        ullog_err("cannot allocate tree node children");
+        rc = -1;
+        goto bail;
+    }
+    tree->kids[tree->kids_n] = kid - idx;
+    NODE(tree, idx)->child_first = tree->kids_n++;
+    NODE(tree, idx)->child_count = 1;
+
+    NODE(tree, idx)->tmpl = tree->parts_n;
+    for (ret = xmlTextReaderMoveToFirstAttribute(reader); ret == 1; 
+            ret = xmlTextReaderMoveToNextAttribute(reader)) {
+        name = xmlTextReaderConstName(reader);
+        value = xmlTextReaderConstValue(reader);
+        if (xmlStrcmp(name, (const xmlChar *) "ref") == 0 || 
+                xmlStrcmp(name, (const xmlChar *) "id") == 0) {
+            continue;
+        }
+        if (_grow((void **) &tree->parts, &tree->parts_size, 
+                    tree->parts_n + 1, sizeof(tmpl_part_t))) {
+            ullog_err("cannot allocate subtree params");
+            rc = -1;
+            goto bail;
+        }
+        part = &tree->parts[tree->parts_n++];
+        memset(part, 0, sizeof(tmpl_part_t));
+        part->lit_len = value ? strlen((const char *) value) : 0;
+        if ((part->lit_len && 
+                    (part->lit = _pool_add(tree, (const char *) value, part->lit_len)) == 0) || 
+                (part->var = _var_slot(tree, (const char *) name)) == 0) {
+            ullog_err("cannot store subtree param '%s'", name);
+            rc = -1;
+            goto bail;
+        }
+        ++NODE(tree, idx)->tmpl_n;
+    }
+    xmlTextReaderMoveToElement(reader);
+
+    // captures of fragment follow params, both get own slots in each use
+    NODE(tree, idx)->frame_n = NODE(tree, idx)->tmpl_n;
+    for (i = 0; i < item->locals_n; ++i) {
+        for (j = 0; j < NODE(tree, idx)->tmpl_n; ++j) {
+            if (tree->parts[NODE(tree, idx)->tmpl + j].var == item->locals[i]) {
+                break;
+            }
+        }
+        if (j < NODE(tree, idx)->tmpl_n) {
+            continue;
+        }
+        if (_grow((void **) &tree->parts, &tree->parts_size, 
+                    tree->parts_n + 1, sizeof(tmpl_part_t))) {
+            ullog_err("cannot allocate subtree params");
+            rc = -1;
+            goto bail;
+        }
+        part = &tree->parts[tree->parts_n++];
+        memset(part, 0, sizeof(tmpl_part_t));
+        part->var = item->locals[i];
+        ++NODE(tree, idx)->frame_n;
+    }
+
+    bail:
+    if (ref) xmlFree(ref);
+
+    ullog_debug("exit");
+    return rc;
+}
+
+/**
+ * \brief   compile element reader is positioned at and its children 
+ *  into tree nodes, reader is left at end of element
+ * \return:
+ *  0 - success, index of compiled node is in idx
+ *  -1 - error
+ */
+static int
+compileNode(bt_tree_t *tree, xmlTextReaderPtr reader, unsigned int *idx)
+{
+    ullog_debug("enter");
+
+    int rc = 0;
+    int ret = 1;
+    int depth = xmlTextReaderDepth(reader);
+    int empty = xmlTextReaderIsEmptyElement(reader);
+    int type = 0;
+    const xmlChar *name = xmlTextReaderConstName(reader);
+    xmlChar *node_type = NULL;
+    unsigned int *kids = NULL;
+    unsigned int kids_n = 0;
+    size_t kids_size = 0;
+    unsigned int kid = 0;
+    unsigned int success_threshold = UINT_MAX;
+    unsigned int failure_threshold = UINT_MAX;
+    node_kind_t kind = NODE_SEQUENCE;
+
+    if (xmlStrcmp(name, (const xmlChar *) "action") == 0) {
+        kind = NODE_ACTION;
+    } else if (xmlStrcmp(name, (const xmlChar *) "sequence") == 0) {
+        kind = NODE_SEQUENCE;
+    } else if (xmlStrcmp(name, (const xmlChar *) "select") == 0) {
+        kind = NODE_SELECT;
+    } else if (xmlStrcmp(name, (const xmlChar *) "parallel") == 0) {
+        kind = NODE_PARALLEL;
+    } else if (xmlStrcmp(name, (const xmlChar *) "decorator") == 0) {
+        node_type = xmlTextReaderGetAttribute(reader, (const xmlChar *) "type");
+        if (node_type && 
+                xmlStrcmp(node_type, (const xmlChar *) "succeeder") == 0) {
+            kind = NODE_DECORATOR_SUCCEEDER;
+        } else if (node_type && 
+                xmlStrcmp(node_type, (const xmlChar *) "timeout") == 0) {
+            kind = NODE_DECORATOR_TIMEOUT;
+        } else if (node_type && 
+                xmlStrcmp(node_type, (const xmlChar *) "retry") == 0) {
+            kind = NODE_DECORATOR_RETRY;
+        } else if (node_type && 
+                xmlStrcmp(node_type, (const xmlChar *) "until_success") == 0) {
+            // retry without bound
+            kind = NODE_DECORATOR_RETRY;
+        } else if (node_type && 
+                xmlStrcmp(node_type, (const xmlChar *) "repeat") == 0) {
+            kind = NODE_DECORATOR_REPEAT;
+        } else {
+            ullog_err("node '%s' is not supported", name);
+            _xmlDump(reader);
+            rc = -1;
+            goto bail;
+        }
+    } else if (xmlStrcmp(name, (const xmlChar *) "subtree") == 0) {
+        kind = NODE_SUBTREE;
+    } else if (xmlStrcmp(name, (const xmlChar *) "bt") == 0 && 
+            tree->nodes_n == 0) {
+        kind = NODE_ROOT;
+    } else if (xmlStrcmp(name, (const xmlChar *) "bt") == 0 && 
+            tree->compile_depth && xmlTextReaderDepth(reader) == 0) {
+        // whole document used as subtree
+        kind = NODE_SEQUENCE;
+    } else {
+        ullog_err("node '%s' is not supported", name);
+        _xmlDump(reader);
+        rc = -1;
+        goto bail;
+    }
+
+    if (_grow((void **) &tree->nodes, &tree->nodes_size, 
+                tree->nodes_n + 1, sizeof(bt_node_t)) || 
+            _grow((void **) &tree->defs, &tree->defs_size, 
+                tree->defs_n + 1, sizeof(unsigned int))) {
+        ullog_err("cannot allocate tree node");
+        rc = -1;
+        goto bail;
+    }
+    *idx = tree->defs_n++;
+    tree->defs[*idx] = tree->nodes_n++;
+    memset(NODE(tree, *idx), 0, sizeof(bt_node_t));
+    NODE(tree, *idx)->kind = kind;
+    NODE(tree, *idx)->line = xmlTextReaderCurrentNode(reader)->line;
+    NODE(tree, *idx)->id = _prop_intern(tree, reader, "id");
+    if (_prop_uint(reader, "timeout_ms", &NODE(tree, *idx)->timeout_ms)) {
+        _xmlDump(reader);
+        rc = -1;
+        goto bail;
+    }
+    if (kind == NODE_DECORATOR_TIMEOUT && 
+            (_prop_uint(reader, "ms", &NODE(tree, *idx)->timeout_ms) || 
+             !NODE(tree, *idx)->timeout_ms)) {
+        ullog_err("timeout decorator needs ms at line %u", NODE(tree, *idx)->line);
+        rc = -1;
+        goto bail;
+    }
+    if ((kind == NODE_DECORATOR_RETRY || kind == NODE_DECORATOR_REPEAT) && 
+            _prop_uint(reader, "backoff_ms", &NODE(tree, *idx)->backoff_ms)) {
+        _xmlDump(reader);
+        rc = -1;
+        goto bail;
+    }
+    // until_success has no count, retry and repeat need one
+    if ((kind == NODE_DECORATOR_RETRY || kind == NODE_DECORATOR_REPEAT) && 
+            xmlStrcmp(node_type, (const xmlChar *) "until_success") != 0 && 
+            (_prop_uint(reader, "count", &NODE(tree, *idx)->count) || 
+             !NODE(tree, *idx)->count)) {
+        ullog_err("%s decorator needs count at line %u", node_type, 
+                NODE(tree, *idx)->line);
+        rc = -1;
+        goto bail;
+    }
+
+    if (kind == NODE_ACTION) {
+        rc = compileAction(tree, *idx, reader);
+        goto bail;
+    }
+    if (kind == NODE_SUBTREE) {
+        rc = compileSubtree(tree, *idx, reader);
+        goto bail;
+    }
+    // attributes are gone once children are read
+    if (kind == NODE_PARALLEL && 
+            (_prop_uint(reader, "success_threshold", &success_threshold) ||
+             _prop_uint(reader, "failure_threshold", &failure_threshold))) {
+        _xmlDump(reader);
+        rc = -1;
+        goto bail;
+    }
+
+    while (!empty && (ret = xmlTextReaderRead(reader)) == 1) {
+        type = xmlTextReaderNodeType(reader);
+        if (type == XML_READER_TYPE_END_ELEMENT && 
+                xmlTextReaderDepth(reader) == depth) {
+            break;
+        }
+        if (type != XML_READER_TYPE_ELEMENT) {
+            continue;
+        }
+        if (compileNode(tree, reader, &kid)) {
+            rc = -1;
+            goto bail;
+        }
+        if (_grow((void **) &kids, &kids_size, kids_n + 1, sizeof(unsigned int))) {
+            ullog_err("cannot allocate tree node children");
+            rc = -1;
+            goto bail;
+        }
+        kids[kids_n++] = kid - *idx;
+    }
+    if (ret != 1) {
+        ullog_err("unable to read node at line %u", NODE(tree, *idx)->line);
+        rc = -1;
+        goto bail;
+    }
+
+    // children of a node occupy continuous range of kids table
+    if (kids_n) {
+        if (_grow((void **) &tree->kids, &tree->kids_size, 
+                    tree->kids_n + kids_n, sizeof(unsigned int))) {
+            ullog_err("cannot allocate tree node children");
+            rc = -1;
+            goto bail;
+        }
+        memcpy(tree->kids + tree->kids_n, kids, kids_n * sizeof(unsigned int));
+        NODE(tree, *idx)->child_first = tree->kids_n;
+        NODE(tree, *idx)->child_count = kids_n;
+        tree->kids_n += kids_n;
+    }
+
+    if (kind == NODE_PARALLEL) {
+        // succeed when all children succeed, fail when one fails
+        NODE(tree, *idx)->success_threshold = 
+            success_threshold == UINT_MAX ? kids_n : success_threshold;
+        NODE(tree, *idx)->failure_threshold = 
+            failure_threshold == UINT_MAX ? 1 : failure_threshold;
+        if (NODE(tree, *idx)->success_threshold > kids_n || 
+                NODE(tree, *idx)->failure_threshold > kids_n) {
+            ullog_err("parallel threshold is more than %u children", kids_n);
+            printf("source line: %u\n", NODE(tree, *idx)->line);
+            rc = -1;
+            goto bail;
+        }
+    }
+
+    bail:
+    if (node_type) xmlFree(node_type);
+    if (kids) free(kids);
+
+    ullog_debug("exit");
+    return rc;
+}
+
+/**
+ * \brief   allocate runtime state of compiled tree, each use of subtree 
+ *  gets own variable slots after those of tree
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+treeInit(bt_tree_t *tree)
+{
+    unsigned int idx = 0;
+    unsigned int i = 0;
+    unsigned int end = 0;
+
+    tree->frames_n = 0;
+    for (idx = 0; idx < tree->defs_n; ++idx) {
+        tree->frames_n += NODE(tree, idx)->frame_n;
+    }
+    if ((tree->state = _arena_alloc(&tree->arena, 
+                    tree->defs_n * sizeof(bt_state_t))) == NULL || 
+            (tree->streams = _arena_alloc(&tree->arena, 
+                    (tree->streams_n + 1) * sizeof(fp_table_t))) == NULL || 
+            (tree->vars = _arena_alloc(&tree->arena, 
+                    (tree->vars_n + tree->frames_n + 1) * sizeof(bb_var_t))) == NULL) {
+        ullog_err("cannot allocate tree state");
+        return -1;
+    }
+    end = tree->vars_n + 1;
+    for (idx = 0; idx < tree->defs_n; ++idx) {
+        tree->state[idx].rc = RC_UNKNOWN;
+        tree->state[idx].io_fd = -1;
+        tree->state[idx].out_fd = -1;
+        if (NODE(tree, idx)->kind == NODE_SUBTREE) {
+            tree->state[idx].frame = end;
+            end += NODE(tree, idx)->frame_n;
+        }
+    }
+    // uses are in document order, nested use overwrites outer one
+    for (idx = 0; idx < tree->defs_n; ++idx) {
+        if (NODE(tree, idx)->kind != NODE_SUBTREE) {
+            continue;
+        }
+        end = _node_end(tree, idx);
+        for (i = idx + 1; i < end; ++i) {
+            tree->state[i].use = idx;
+        }
+    }
+    return reactorInit(&tree->reactor);
+}
+
+/**
+ * \brief   move tables grown during compile to tree arena
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_tree_pack(bt_tree_t *tree)
+{
+    bt_node_t *nodes = NULL;
+    unsigned int *defs = NULL;
+    unsigned int *kids = NULL;
+    matcher_t *matchers = NULL;
+    glob_tok_t *toks = NULL;
+    tmpl_part_t *parts = NULL;
+    char *strs = NULL;
+
+    if ((nodes = _arena_alloc(&tree->arena, tree->nodes_n * sizeof(bt_node_t))) == NULL || 
+            (defs = _arena_alloc(&tree->arena, tree->defs_n * sizeof(unsigned int))) == NULL || 
+            (kids = _arena_alloc(&tree->arena, tree->kids_n * sizeof(unsigned int))) == NULL || 
+            (matchers = _arena_alloc(&tree->arena, tree->matchers_n * sizeof(matcher_t))) == NULL || 
+            (toks = _arena_alloc(&tree->arena, tree->toks_n * sizeof(glob_tok_t))) == NULL || 
+            (parts = _arena_alloc(&tree->arena, tree->parts_n * sizeof(tmpl_part_t))) == NULL || 
+            (strs = _arena_alloc(&tree->arena, tree->strs_n)) == NULL) {
+        ullog_err("cannot allocate tree");
+        return -1;
+    }
+    memcpy(nodes, tree->nodes, tree->nodes_n * sizeof(bt_node_t));
+    memcpy(defs, tree->defs, tree->defs_n * sizeof(unsigned int));
+    if (tree->kids_n) memcpy(kids, tree->kids, tree->kids_n * sizeof(unsigned int));
+    if (tree->matchers_n) memcpy(matchers, tree->matchers, tree->matchers_n * sizeof(matcher_t));
+    if (tree->toks_n) memcpy(toks, tree->toks, tree->toks_n * sizeof(glob_tok_t));
+    if (tree->parts_n) memcpy(parts, tree->parts, tree->parts_n * sizeof(tmpl_part_t));
+    memcpy(strs, tree->strs, tree->strs_n);
+    free(tree->nodes);
+    free(tree->defs);
+    free(tree->kids);
+    free(tree->matchers);
+    free(tree->toks);
+    free(tree->parts);
+    free(tree->strs);
+    tree->nodes = nodes;
+    tree->defs = defs;
+    tree->kids = kids;
+    tree->matchers = matchers;
+    tree->toks = toks;
+    tree->parts = parts;
+    tree->strs = strs;
+    // tables are not grown any more
+    tree->nodes_size = tree->defs_size = tree->kids_size = tree->matchers_size = 0;
+    tree->toks_size = tree->parts_size = tree->strs_size = 0;
+    return 0;
+}
+
+/**
+ * \brief   compile xml document from reader events into flat tree of nodes, 
+ *  elements are dropped as soon as they are compiled
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+compileTree(bt_tree_t *tree, xmlTextReaderPtr reader, const char *name, 
+        const char *src)
+{
+    ullog_debug("enter");
+
+    int rc = 0;
+    int ret = 0;
+    unsigned int idx = 0;
+
+    memset(tree, 0, sizeof(bt_tree_t));
+    tree->reactor.epfd = -1;
+    tree->compile_src = src;
+    // offset 0 of string pool is empty string
+    if (_grow((void **) &tree->strs, &tree->strs_size, 1, sizeof(char))) {
+        ullog_err("cannot allocate tree strings");
+        rc = -1;
+        goto bail;
+    }
+    tree->strs[0] = '\0';
+    tree->strs_n = 1;
+    // first source is tree xml
+    if (src && _src_add(tree, src)) {
+        rc = -1;
+        goto bail;
+    }
+
+    while ((ret = xmlTextReaderRead(reader)) == 1 && 
+            xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+    }
+    if (ret != 1) {
+        ullog_err("unable to open file %s%s", name, ret ? "" : ": no root element");
+        rc = -1;
+        goto bail;
+    }
+    if (compileNode(tree, reader, &idx)) {
+        ullog_err("unable to compile file %s", name);
+        rc = -1;
+        goto bail;
+    }
+    // rest of document must still be well formed
+    while ((ret = xmlTextReaderRead(reader)) == 1) {
+    }
+    if (ret != 0) {
+        ullog_err("unable to open file %s", name);
+        rc = -1;
+        goto bail;
+    }
+    if (src) {
+        tree->src = tree->srcs[0].path;
+    }
+    ullog_debug("compiled %u nodes of %u definitions %zu string bytes", 
+            tree->defs_n, tree->nodes_n, tree->strs_n);
+    if (_tree_pack(tree) || treeInit(tree)) {
+        rc = -1;
+        goto bail;
+    }
+
+    bail:
+    HASH_CLEAR(hh, tree->intern);
+    HASH_CLEAR(hh, tree->subtrees);
+    tree->compile_src = NULL;
+    _arena_free(&tree->scratch);
+
+    ullog_debug("exit");
+    return rc;
+}
+
+/**
+ * \brief   write runtime state of node and its children to '_state_' 
+ *  attributes of source element, elements are visited in compile order 
+ *  and action state goes to its first element
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_state_walk(bt_tree_t *tree, xmlNodePtr node, unsigned int *idx)
+{
+    xmlNodePtr cur_node = NULL;
+    xmlNodePtr target = node;
+    unsigned int my = (*idx)++;
+    rc_t state_rc = RC_UNKNOWN;
+
+    if (my >= tree->defs_n) {
+        return -1;
+    }
+    // fragment of subtree is not part of document
+    if (NODE(tree, my)->kind == NODE_SUBTREE) {
+        *idx = _node_end(tree, my);
+    }
+    for (cur_node = node->children; cur_node; cur_node = cur_node->next) {
+        if (cur_node->type != XML_ELEMENT_NODE) {
+            continue;
+        }
+        if (NODE(tree, my)->kind == NODE_ACTION) {
+            target = cur_node;
+            break;
+        }
+        if (_state_walk(tree, cur_node, idx)) {
+            return -1;
+        }
+    }
+    state_rc = tree->state[my].rc;
+    if (state_rc != RC_UNKNOWN && !xmlSetProp(target, (const xmlChar *) "_state_", 
+                (const xmlChar *) rcs_str_mapping[state_rc].str)) {
+        ullog_err("cannot write node state '%s' to tree", 
+                rcs_str_mapping[state_rc].str);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \brief   write source document of tree with runtime state of nodes, 
+ *  document is read again since it is not kept after compile
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+treeSaveState(bt_tree_t *tree, const char *filename)
+{
+    int rc = 0;
+    xmlDocPtr doc = NULL;
+    xmlNodePtr root = NULL;
+    unsigned int idx = 0;
+
+    if (!tree->src) {
+        ullog_err("tree loaded from memory has no source for node states");
+        return -1;
+    }
+    if ((doc = xmlReadFile(NODE_STR(tree, tree->src), NULL, 0)) == NULL || 
+            (root = xmlDocGetRootElement(doc)) == NULL) {
+        ullog_err("unable to open file %s", NODE_STR(tree, tree->src));
+        rc = -1;
+        goto bail;
+    }
+    if (_state_walk(tree, root, &idx) || idx != tree->defs_n) {
+        ullog_err("file %s does not match compiled tree", NODE_STR(tree, tree->src));
+        rc = -1;
+        goto bail;
+    }
+    if (xmlSaveFormatFile(filename, doc, 1) < 0) {
+        rc = -1;
+        goto bail;
+    }
+
+    bail:
+    if (doc) xmlFreeDoc(doc);
+    return rc;
+}
+
+static unsigned long long
+_hash_bytes(unsigned long long hash, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    size_t i = 0;
+
+    for (i = 0; i < len; ++i) {
+        hash = (hash ^ p[i]) * 1099511628211ULL; // FNV-1a
+    }
+    return hash;
+}
+
+static unsigned long long
+_hash_uint(unsigned long long hash, unsigned int v)
+{
+    return _hash_bytes(hash, &v, sizeof(v));
+}
+
+/**
+ * \brief   hash of compiled tables, checkpoint is only restored into 
+ *  tree compiled from same source, 
+ *  node fields are hashed one by one, padding between them is random
+ */
+static unsigned long long
+_tree_hash(const bt_tree_t *tree)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    const bt_node_t *n = NULL;
+    unsigned int i = 0;
+
+    for (i = 0; i < tree->nodes_n; ++i) {
+        n = &tree->nodes[i];
+        hash = _hash_uint(hash, n->kind);
+        hash = _hash_uint(hash, n->action);
+        hash = _hash_uint(hash, n->child_first);
+        hash = _hash_uint(hash, n->child_count);
+        hash = _hash_uint(hash, n->id);
+        hash = _hash_uint(hash, n->stream_id);
+        hash = _hash_uint(hash, n->stream);
+        hash = _hash_uint(hash, n->var);
+        hash = _hash_uint(hash, n->tmpl);
+        hash = _hash_uint(hash, n->tmpl_n);
+        hash = _hash_uint(hash, n->frame_n);
+        hash = _hash_uint(hash, n->value);
+        hash = _hash_uint(hash, n->value_len);
+        hash = _hash_uint(hash, n->line);
+        hash = _hash_uint(hash, n->settle);
+        hash = _hash_uint(hash, n->settle_ms);
+        hash = _hash_uint(hash, n->shell);
+        hash = _hash_uint(hash, n->matcher);
+        hash = _hash_uint(hash, n->success_threshold);
+        hash = _hash_uint(hash, n->failure_threshold);
+        hash = _hash_uint(hash, n->timeout_ms);
+        hash = _hash_uint(hash, n->count);
+        hash = _hash_uint(hash, n->backoff_ms);
+        hash = _hash_uint(hash, n->cache_ttl_ms);
+    }
+    hash = _hash_bytes(hash, tree->defs, tree->defs_n * sizeof(unsigned int));
+    hash = _hash_bytes(hash, tree->kids, tree->kids_n * sizeof(unsigned int));
+    return _hash_bytes(hash, tree->strs, tree->strs_n);
+}
+
+static unsigned int
+_ckpt_sum(const btec_rec_t *rec, const char *buf)
+{
+    unsigned int sum = 2166136261U; // FNV-1a
+    btec_rec_t r = *rec;
+    const unsigned char *p = (const unsigned char *) &r;
+    size_t i = 0;
+
+    r.sum = 0;
+    for (i = 0; i < sizeof(r); ++i) {
+        sum = (sum ^ p[i]) * 16777619U;
+    }
+    for (i = 0; i < rec->len; ++i) {
+        sum = (sum ^ (unsigned char) buf[i]) * 16777619U;
+    }
+    return sum;
+}
+
+/**
+ * \brief   append record to checkpoint of tree, nodes succeeding while 
+ *  some stream is open are not recorded, since stream process does not 
+ *  survive restart and its actions must run again
+ *  checkpoint is dropped on write error
+ * \return:
+ *  1 - record is appended
+ *  0 - nothing is appended
+ */
+static int
+_ckpt_add(bt_tree_t *tree, ckpt_kind_t kind, unsigned int slot, 
+        const char *buf, size_t len)
+{
+    btec_rec_t rec;
+    unsigned int i = 0;
+
+    if (kind == CKPT_NODE) {
+        for (i = 1; i <= tree->streams_n; ++i) {
+            if (tree->streams[i].fd > 0) {
+                return 0;
+            }
+        }
+    }
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = kind;
+    rec.slot = slot;
+    rec.len = len;
+    rec.sum = _ckpt_sum(&rec, buf);
+    if (fwrite(&rec, sizeof(rec), 1, tree->ckpt) != 1 || 
+            (len && fwrite(buf, len, 1, tree->ckpt) != 1)) {
+        ullog_err("cannot write checkpoint: %s", strerror(errno));
+        fclose(tree->ckpt);
+        tree->ckpt = NULL;
+        return 0;
+    }
+    ++tree->ckpt_unsynced;
+    return 1;
+}
+
+/**
+ * \brief   write appended checkpoint records each tick, they are synced 
+ *  to disk once CKPT_SYNC_MS passed or CKPT_SYNC_RECORDS are appended 
+ *  since last sync, and when forced at tree end, 
+ *  checkpoint which cannot be written or synced is dropped
+ */
+static void
+treeCheckpointSync(bt_tree_t *tree, int force)
+{
+    if (!tree->ckpt || !tree->ckpt_unsynced) {
+        return;
+    }
+    if (fflush(tree->ckpt)) {
+        ullog_err("cannot write checkpoint: %s", strerror(errno));
+        fclose(tree->ckpt);
+        tree->ckpt = NULL;
+        return;
+    }
+    if (!force && tree->ckpt_unsynced < CKPT_SYNC_RECORDS && 
+            _now_ms() - tree->ckpt_sync < CKPT_SYNC_MS) {
+        return;
+    }
+    if (fsync(fileno(tree->ckpt))) {
+        ullog_err("cannot sync checkpoint: %s", strerror(errno));
+        fclose(tree->ckpt);
+        tree->ckpt = NULL;
+        return;
+    }
+    tree->ckpt_sync = _now_ms();
+    tree->ckpt_unsynced = 0;
+}
+
+/**
+ * \brief   restore succeeded nodes and captured variables of checkpoint, 
+ *  reading stops at first torn or corrupted record
+ * \return:
+ *  0 - success, missing checkpoint restores nothing
+ *  -1 - checkpoint belongs to other tree or cannot be read
+ */
+static int
+_ckpt_load(bt_tree_t *tree, const char *filename)
+{
+    int rc = 0;
+    FILE *fp = NULL;
+    btec_header_t hdr;
+    btec_rec_t rec;
+    char *buf = NULL;
+    size_t size = 0;
+    unsigned int nodes = 0;
+    unsigned int vars = 0;
+
+    if ((fp = fopen(filename, "rb")) == NULL) {
+        if (errno == ENOENT) {
+            goto bail;
+        }
+        ullog_err("cannot open checkpoint %s: %s", filename, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || 
+            memcmp(hdr.magic, BTEC_MAGIC, sizeof(hdr.magic)) || 
+            hdr.version != BTEC_VERSION || hdr.tree_hash != _tree_hash(tree) || 
+            hdr.nodes_n != tree->defs_n || 
+            hdr.vars_n != tree->vars_n + tree->frames_n) {
+        ullog_err("checkpoint %s does not belong to tree", filename);
+        rc = -1;
+        goto bail;
+    }
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+        if (_grow((void **) &buf, &size, (size_t) rec.len + 1, 1)) {
+            break;
+        }
+        if ((rec.len && fread(buf, rec.len, 1, fp) != 1) || 
+                rec.sum != _ckpt_sum(&rec, buf)) {
+            break;
+        }
+        if (rec.kind == CKPT_NODE && rec.slot < tree->defs_n) {
+            tree->state[rec.slot].rc = RC_SUCCESS;
+            tree->state[rec.slot].restored = 1;
+            ++nodes;
+        } else if (rec.kind == CKPT_VAR && rec.slot && 
+                rec.slot <= tree->vars_n + tree->frames_n) {
+            if (_var_set(tree, rec.slot, buf, rec.len)) {
+                ullog_err("cannot restore variable");
+                rc = -1;
+                goto bail;
+            }
+            ++vars;
+        } else {
+            break;
+        }
+    }
+    btlog(LOG_CKPT_RESTORE, BTELOG_NO_NODE, nodes, vars, 0);
+
+    bail:
+    if (buf) free(buf);
+    if (fp) fclose(fp);
+    return rc;
+}
+
+/**
+ * \brief   start checkpoint of tree, restored state is written as 
+ *  compact checkpoint replacing old one and records are appended to it
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+treeCheckpoint(bt_tree_t *tree, const char *filename, int resume)
+{
+    int rc = 0;
+    FILE *fp = NULL;
+    btec_header_t hdr;
+    char tmp[PATH_MAX] = "";
+    char dir[PATH_MAX] = "";
+    char *slash = NULL;
+    unsigned int idx = 0;
+    int fd = -1;
+
+    if (tree->ckpt) {
+        treeCheckpointSync(tree, 1);
+        fclose(tree->ckpt);
+        tree->ckpt = NULL;
+    }
+    if (resume && _ckpt_load(tree, filename)) {
+        rc = -1;
+        goto bail;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BTEC_MAGIC, sizeof(hdr.magic));
+    hdr.version = BTEC_VERSION;
+    hdr.tree_hash = _tree_hash(tree);
+    hdr.nodes_n = tree->defs_n;
+    hdr.vars_n = tree->vars_n + tree->frames_n;
+    if (snprintf(tmp, sizeof(tmp), "%s.%d", filename, (int) getpid()) >= sizeof(tmp)) {
+        ullog_err("path %s is too long", filename);
+        rc = -1;
+        goto bail;
+    }
+    if ((fp = fopen(tmp, "wb")) == NULL) {
+        ullog_err("cannot create %s: %s", tmp, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    // records are written to new checkpoint while it is not yet in place
+    tree->ckpt = fp;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+        fclose(fp);
+        tree->ckpt = NULL;
+    }
+    for (idx = 1; tree->ckpt && idx <= tree->vars_n + tree->frames_n; ++idx) {
+        if (tree->vars[idx].kind == VAR_TEXT) {
+            _ckpt_add(tree, CKPT_VAR, idx, tree->vars[idx].buf, tree->vars[idx].len);
+        }
+    }
+    for (idx = 0; tree->ckpt && idx < tree->defs_n; ++idx) {
+        if (tree->state[idx].restored) {
+            _ckpt_add(tree, CKPT_NODE, idx, NULL, 0);
+        }
+    }
+    if (!tree->ckpt || fflush(fp) || fsync(fileno(fp))) {
+        // failed _ckpt_add closed fp already
+        if (tree->ckpt) fclose(fp);
+        tree->ckpt = NULL;
+        fp = NULL;
+        ullog_err("cannot write %s: %s", tmp, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    if (rename(tmp, filename)) {
+        ullog_err("cannot rename %s to %s: %s", tmp, filename, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    // rename is durable once directory is synced
+    snprintf(dir, sizeof(dir), "%s", filename);
+    if ((slash = strrchr(dir, '/')) != NULL) {
+        slash[slash == dir ? 1 : 0] = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+    if ((fd = open(dir, O_RDONLY)) >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    tree->ckpt_sync = _now_ms();
+    tree->ckpt_unsynced = 0;
+    fp = NULL;
+
+    bail:
+    if (fp) {
+        fclose(fp);
+        tree->ckpt = NULL;
+    }
+    if (rc && *tmp) unlink(tmp);
+    return rc;
+}
+
+/**
+ * \brief   process tree root once
+ * \return:
+ *  result of root node
+ */
+static rc_t
+treeTick(bt_tree_t *tree)
+{
+    rc_t task_rc = RC_RUNNING;
+    long long t0 = g_stats ? _now_ns() : 0;
+
+    // transient strings of previous tick are not used any more
+    _arena_reset(&tree->scratch);
+    task_rc = processRootNode(tree);
+    ++tree->stats.ticks;
+    if (g_stats) tree->stats.tick_ns += _now_ns() - t0;
+    return task_rc;
+}
+
+/**
+ * \brief   forward exec output to sink of tree
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+treeOutput(bt_tree_t *tree, const char *buf, size_t len)
+{
+    if (tree->output_cb) {
+        tree->output_cb(tree->output_ctx, buf, len);
+        return 0;
+    }
+    return _sink_write(STDOUT_FILENO, buf, len);
+}
+
+/**
+ * \brief   print run statistics of tree to stderr
+ */
+static void
+treeStats(bt_tree_t *tree, long long run_ns)
+{
+    const bt_stats_t *ss = &tree->stats;
+
+#define PER(a, b) ((b) ? (double) (a) / (double) (b) : 0.0)
+    fprintf(stderr, "stats: run_ms %.3f ticks %lu ticks_per_sec %.0f "
+            "dispatches %lu ns_per_dispatch %.1f\n", 
+            run_ns / 1e6, ss->ticks, PER(ss->ticks * 1e9, run_ns), 
+            ss->dispatches, PER(ss->tick_ns, ss->dispatches));
+    fprintf(stderr, "stats: spawns %lu us_per_spawn %.1f cache_hits %lu\n", 
+            ss->spawns, PER(ss->spawn_ns / 1e3, ss->spawns), ss->cache_hits);
+    fprintf(stderr, "stats: expect_bytes %llu expect_mb_per_sec %.1f\n", 
+            ss->expect_bytes, PER(ss->expect_bytes * 1e3, ss->expect_ns));
+    fprintf(stderr, "stats: write_bytes %llu write_mb_per_sec %.1f\n", 
+            ss->write_bytes, PER(ss->write_bytes * 1e3, ss->write_ns));
+    fprintf(stderr, "stats: arena_kb %zu scratch_kb %zu\n", 
+            tree->arena.bytes / 1024, tree->scratch.bytes / 1024);
+#undef PER
+}
+
+static void
+treeFree(bt_tree_t *tree)
+{
+    unsigned int idx = 0;
+    unsigned int slot = 0;
+
+    for (slot = 1; tree->streams && slot <= tree->streams_n; ++slot) {
+        if (tree->streams[slot].fd > 0) {
+            _stream_close(tree, &tree->streams[slot]);
+        }
+    }
+    _stream_reap(tree, 1);
+    if (tree->reaps) free(tree->reaps);
+
+    if (tree->state) {
+        for (idx = 0; idx < tree->defs_n; ++idx) {
+            if (tree->state[idx].pid > 0) _exec_reap(&tree->state[idx], 0);
+            if (tree->state[idx].tmpl_buf) free(tree->state[idx].tmpl_buf);
+            if (tree->state[idx].cache_buf) free(tree->state[idx].cache_buf);
+        }
+    }
+    for (slot = 1; tree->vars && slot <= tree->vars_n + tree->frames_n; ++slot) {
+        if (tree->vars[slot].buf) free(tree->vars[slot].buf);
+    }
+    if (tree->ckpt) {
+        treeCheckpointSync(tree, 1);
+        if (tree->ckpt) fclose(tree->ckpt);
+    }
+    reactorFree(&tree->reactor);
+    if (tree->out_buf) free(tree->out_buf);
+    if (tree->trace) free(tree->trace);
+    if (tree->map) munmap(tree->map, tree->map_size);
+    // tables still being grown by failed compile
+    if (tree->matchers_size) free(tree->matchers);
+    if (tree->toks_size) free(tree->toks);
+    if (tree->parts_size) free(tree->parts);
+    if (tree->nodes_size) free(tree->nodes);
+    if (tree->defs_size) free(tree->defs);
+    if (tree->kids_size) free(tree->kids);
+    if (tree->strs_size) free(tree->strs);
+    if (tree->srcs) free(tree->srcs);
+    HASH_CLEAR(hh, tree->intern);
+    HASH_CLEAR(hh, tree->subtrees);
+    _arena_free(&tree->scratch);
+    _arena_free(&tree->arena);
+    memset(tree, 0, sizeof(bt_tree_t));
+}
+
+/**
+ * \brief   write table to image at next aligned offset
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_image_section(FILE *fp, const void *buf, size_t len, unsigned long long *off)
+{
+    static const char pad[BTEB_ALIGN];
+    long pos = ftell(fp);
+    size_t n = 0;
+
+    if (pos < 0) {
+        return -1;
+    }
+    n = (BTEB_ALIGN - pos % BTEB_ALIGN) % BTEB_ALIGN;
+    if (fwrite(pad, 1, n, fp) != n) {
+        return -1;
+    }
+    *off = pos + n;
+    if (len && fwrite(buf, 1, len, fp) != len) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \brief   write compiled tree to binary image with path and 
+ *  stat of its source and subtree files, image replaces filename 
+ *  at once so running readers keep old one
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+treeSave(bt_tree_t *tree, const char *filename)
+{
+    ullog_debug("enter");
+
+    int rc = 0;
+    FILE *fp = NULL;
+    char tmp[PATH_MAX] = "";
+    bteb_header_t hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BTEB_MAGIC, sizeof(hdr.magic));
+    hdr.version = BTEB_VERSION;
+    hdr.endian = BTEB_ENDIAN;
+    hdr.header_size = sizeof(bteb_header_t);
+    hdr.node_size = sizeof(bt_node_t);
+    hdr.matcher_size = sizeof(matcher_t);
+    hdr.tok_size = sizeof(glob_tok_t);
+    hdr.part_size = sizeof(tmpl_part_t);
+    hdr.src_size = sizeof(bteb_src_t);
+    hdr.src_path = tree->src;
+    hdr.srcs_n = tree->srcs_n;
+    hdr.nodes_n = tree->nodes_n;
+    hdr.defs_n = tree->defs_n;
+    hdr.kids_n = tree->kids_n;
+    hdr.matchers_n = tree->matchers_n;
+    hdr.streams_n = tree->streams_n;
+    hdr.vars_n = tree->vars_n;
+    hdr.parts_n = tree->parts_n;
+    hdr.toks_n = tree->toks_n;
+    hdr.strs_n = tree->strs_n;
+
+    if (snprintf(tmp, sizeof(tmp), "%s.%d", filename, (int) getpid()) >= sizeof(tmp)) {
+        ullog_err("path %s is too long", filename);
+        rc = -1;
+        goto bail;
+    }
+    if ((fp = fopen(tmp, "wb")) == NULL) {
+        ullog_err("cannot create %s: %s", tmp, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || 
+            _image_section(fp, tree->nodes, 
+                tree->nodes_n * sizeof(bt_node_t), &hdr.nodes_off) || 
+            _image_section(fp, tree->defs, 
+                tree->defs_n * sizeof(unsigned int), &hdr.defs_off) || 
+            _image_section(fp, tree->kids, 
+                tree->kids_n * sizeof(unsigned int), &hdr.kids_off) || 
+            _image_section(fp, tree->matchers, 
+                tree->matchers_n * sizeof(matcher_t), &hdr.matchers_off) || 
+            _image_section(fp, tree->toks, 
+                tree->toks_n * sizeof(glob_tok_t), &hdr.toks_off) || 
+            _image_section(fp, tree->parts, 
+                tree->parts_n * sizeof(tmpl_part_t), &hdr.parts_off) || 
+            _image_section(fp, tree->strs, tree->strs_n, &hdr.strs_off) || 
+            _image_section(fp, tree->srcs, 
+                tree->srcs_n * sizeof(bteb_src_t), &hdr.srcs_off) || 
+            fseek(fp, 0, SEEK_SET) || 
+            fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+        ullog_err("cannot write %s: %s", tmp, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    if (fclose(fp)) {
+        fp = NULL;
+        ullog_err("cannot write %s: %s", tmp, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    fp = NULL;
+    if (rename(tmp, filename)) {
+        ullog_err("cannot rename %s to %s: %s", tmp, filename, strerror(errno));
+        rc = -1;
+        goto bail;
+    }
+    ullog_debug("wrote %u nodes %zu string bytes to %s", 
+            tree->defs_n, tree->strs_n, filename);
+
+    bail:
+    if (fp) fclose(fp);
+    if (rc && *tmp) unlink(tmp);
+
+    ullog_debug("exit");
+    return rc;
+}
+
+/**
+ * \brief   check that tables of mapped image only refer inside image, 
+ *  children follow their parent so image cannot make loops
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_image_check(bt_tree_t *tree)
+{
+    unsigned int idx = 0;
+    unsigned int i = 0;
+    const bt_node_t *n = NULL;
+    const matcher_t *m = NULL;
+    const tmpl_part_t *part = NULL;
+
+    // every variable is named by node or template part
+    if (!tree->nodes_n || !tree->defs_n || tree->defs[0] >= tree->nodes_n || 
+            NODE(tree, 0)->kind != NODE_ROOT || 
+            tree->streams_n > tree->nodes_n || 
+            tree->vars_n > tree->nodes_n + tree->parts_n || 
+            !tree->strs_n || tree->strs[0] || tree->strs[tree->strs_n - 1]) {
+        return -1;
+    }
+    for (idx = 0; idx < tree->nodes_n; ++idx) {
+        n = &tree->nodes[idx];
+        if (n->kind > NODE_DECORATOR_REPEAT || n->action > ACTION_MATCH || 
+                n->id >= tree->strs_n || n->stream_id >= tree->strs_n || 
+                n->stream > tree->streams_n || n->var > tree->vars_n || 
+                (unsigned long long) n->tmpl + n->tmpl_n > tree->parts_n || 
+                (unsigned long long) n->tmpl + n->frame_n > tree->parts_n || 
+                (n->frame_n && 
+                 (n->kind != NODE_SUBTREE || n->frame_n < n->tmpl_n)) || 
+                (unsigned long long) n->value + n->value_len >= tree->strs_n || 
+                (unsigned long long) n->child_first + n->child_count > tree->kids_n || 
+                ((n->action == ACTION_EXPECT || n->action == ACTION_MATCH) && 
+                 n->matcher >= tree->matchers_n)) {
+            return -1;
+        }
+    }
+    for (idx = 0; idx < tree->defs_n; ++idx) {
+        if (tree->defs[idx] >= tree->nodes_n) {
+            return -1;
+        }
+        n = NODE(tree, idx);
+        for (i = 0; i < n->child_count; ++i) {
+            if (!tree->kids[n->child_first + i] || 
+                    (unsigned long long) idx + tree->kids[n->child_first + i] >= 
+                    tree->defs_n) {
+                return -1;
+            }
+        }
+    }
+    for (i = 0; i < tree->matchers_n; ++i) {
+        m = &tree->matchers[i];
+        if ((unsigned long long) m->lit + m->lit_len >= tree->strs_n || 
+                (unsigned long long) m->toks + m->toks_n > tree->toks_n) {
+            return -1;
+        }
+    }
+    for (i = 0; i < tree->parts_n; ++i) {
+        part = &tree->parts[i];
+        if ((unsigned long long) part->lit + part->lit_len >= tree->strs_n || 
+                part->var > tree->vars_n) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief   map binary image of compiled tree
+ * \return:
+ *  tree - success
+ *  NULL - error or fallback is set: 
+ *      1 - file is not binary image, 
+ *      2 - image is stale, its source xml or file of its subtree changed, 
+ *          source xml is in src
+ */
+static bte_tree_t *
+_tree_map(const char *filename, int *fallback, char *src, size_t src_size)
+{
+    ullog_debug("enter");
+
+    bt_tree_t *tree = NULL;
+    int fd = -1;
+    struct stat st;
+    struct stat src_st;
+    void *map = MAP_FAILED;
+    const bteb_header_t *hdr = NULL;
+    const bteb_src_t *srcs = NULL;
+    const char *src_path = NULL;
+    unsigned int i = 0;
+
+    *fallback = 0;
+    if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) < 0 || fstat(fd, &st)) {
+        ullog_err("unable to open file %s", filename);
+        goto bail;
+    }
+    if (st.st_size < 4 || 
+            (map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED || 
+            memcmp(map, BTEB_MAGIC, 4)) {
+        *fallback = 1;
+        goto bail;
+    }
+    if (st.st_size < sizeof(bteb_header_t)) {
+        ullog_err("binary tree %s is truncated", filename);
+        goto bail;
+    }
+    hdr = map;
+    if (hdr->version != BTEB_VERSION || hdr->endian != BTEB_ENDIAN || 
+            hdr->header_size != sizeof(bteb_header_t) || 
+            hdr->node_size != sizeof(bt_node_t) || 
+            hdr->matcher_size != sizeof(matcher_t) || 
+            hdr->tok_size != sizeof(glob_tok_t) || 
+            hdr->part_size != sizeof(tmpl_part_t) || 
+            hdr->src_size != sizeof(bteb_src_t)) {
+        ullog_err("binary tree %s has version %u of other build, compile it again", 
+                filename, hdr->version);
+        goto bail;
+    }
+    if (hdr->nodes_off + (unsigned long long) hdr->nodes_n * sizeof(bt_node_t) > st.st_size || 
+            hdr->defs_off + (unsigned long long) hdr->defs_n * sizeof(unsigned int) > st.st_size || 
+            hdr->kids_off + (unsigned long long) hdr->kids_n * sizeof(unsigned int) > st.st_size || 
+            hdr->matchers_off + (unsigned long long) hdr->matchers_n * sizeof(matcher_t) > st.st_size || 
+            hdr->toks_off + (unsigned long long) hdr->toks_n * sizeof(glob_tok_t) > st.st_size || 
+            hdr->parts_off + (unsigned long long) hdr->parts_n * sizeof(tmpl_part_t) > st.st_size || 
+            hdr->strs_off + hdr->strs_n > st.st_size || hdr->strs_off + hdr->strs_n < hdr->strs_off || 
+            hdr->srcs_off + (unsigned long long) hdr->srcs_n * sizeof(bteb_src_t) > st.st_size || 
+            (hdr->nodes_off | hdr->defs_off | hdr->kids_off | hdr->matchers_off | hdr->toks_off | 
+             hdr->parts_off | hdr->srcs_off) % BTEB_ALIGN || 
+            !hdr->strs_n || ((const char *) map)[hdr->strs_off + hdr->strs_n - 1] || 
+            hdr->src_path >= hdr->strs_n) {
+        ullog_err("binary tree %s is truncated", filename);
+        goto bail;
+    }
+
+    // image is not used once source or file of its subtree changed, 
+    // missing files do not make it stale
+    src_path = (const char *) map + hdr->strs_off + hdr->src_path;
+    srcs = (const bteb_src_t *) ((const char *) map + hdr->srcs_off);
+    if (*src_path && stat(src_path, &src_st) == 0 && strlen(src_path) < src_size) {
+        for (i = 0; i < hdr->srcs_n; ++i) {
+            if (srcs[i].path < hdr->strs_n && 
+                    stat((const char *) map + hdr->strs_off + srcs[i].path, &src_st) == 0 && 
+                    (src_st.st_mtime != srcs[i].mtime || src_st.st_size != srcs[i].size)) {
+                break;
+            }
+        }
+        if (i < hdr->srcs_n) {
+            ullog_info("binary tree %s is stale, loading %s", filename, src_path);
+            strcpy(src, src_path);
+            *fallback = 2;
+            goto bail;
+        }
+    }
+
+    if ((tree = calloc(1, sizeof(bt_tree_t))) == NULL) {
+        ullog_err("cannot allocate tree");
+        goto bail;
+    }
+    tree->reactor.epfd = -1;
+    tree->map = map;
+    tree->map_size = st.st_size;
+    map = MAP_FAILED;
+    tree->nodes = (bt_node_t *) ((char *) tree->map + hdr->nodes_off);
+    tree->nodes_n = hdr->nodes_n;
+    tree->defs = (unsigned int *) ((char *) tree->map + hdr->defs_off);
+    tree->defs_n = hdr->defs_n;
+    tree->kids = (unsigned int *) ((char *) tree->map + hdr->kids_off);
+    tree->kids_n = hdr->kids_n;
+    tree->matchers = (matcher_t *) ((char *) tree->map + hdr->matchers_off);
+    tree->matchers_n = hdr->matchers_n;
+    tree->toks = (glob_tok_t *) ((char *) tree->map + hdr->toks_off);
+    tree->toks_n = hdr->toks_n;
+    tree->parts = (tmpl_part_t *) ((char *) tree->map + hdr->parts_off);
+    tree->parts_n = hdr->parts_n;
+    tree->streams_n = hdr->streams_n;
+    tree->vars_n = hdr->vars_n;
+    tree->strs = (char *) tree->map + hdr->strs_off;
+    tree->strs_n = hdr->strs_n;
+    tree->src = hdr->src_path;
+    if (_image_check(tree)) {
+        ullog_err("binary tree %s is corrupted", filename);
+        treeFree(tree);
+        free(tree);
+        tree = NULL;
+        goto bail;
+    }
+    if (treeInit(tree)) {
+        treeFree(tree);
+        free(tree);
+        tree = NULL;
+        goto bail;
+    }
+    ullog_debug("mapped %u nodes %zu string bytes of %s", 
+            tree->defs_n, tree->strs_n, filename);
+
+    bail:
+    if (map != MAP_FAILED) munmap(map, st.st_size);
+    if (fd >= 0) close(fd);
+
+    ullog_debug("exit");
+    return tree;
+}
+
+/**
+ * \brief   compile tree from reader, reader is freed
+ * \return:
+ *  tree - success
+ *  NULL - error
+ */
+static bte_tree_t *
+_tree_load(xmlTextReaderPtr reader, const char *name, const char *src)
+{
+    bt_tree_t *tree = NULL;
+
+    if (reader == NULL) {
+        ullog_err("unable to open file %s", name);
+        return NULL;
+    }
+    if ((tree = calloc(1, sizeof(bt_tree_t))) == NULL) {
+        ullog_err("cannot allocate tree");
+        goto bail;
+    }
+    tree->reactor.epfd = -1;
+    if (compileTree(tree, reader, name, src)) {
+        treeFree(tree);
+        free(tree);
+        tree = NULL;
+        goto bail;
+    }
+
+    bail:
+    xmlFreeTextReader(reader);
+    return tree;
+}
+
+bte_tree_t *
+bte_load_file(const char *filename)
+{
+    bte_tree_t *tree = NULL;
+    int fallback = 0;
+    char src[PATH_MAX] = "";
+
+    tree = _tree_map(filename, &fallback, src, sizeof(src));
+    if (fallback == 2) {
+        filename = src;
+    } else if (fallback != 1) {
+        return tree;
+    }
+    ullog_debug("start xmlReaderForFile");
+    return _tree_load(xmlReaderForFile(filename, NULL, 0), filename, filename);
+}
+
+int
+bte_compile(const char *filename, const char *out)
+{
+    ullog_debug("enter");
+
+    int rc = 0;
+    bt_tree_t *tree = NULL;
+    char src[PATH_MAX] = "";
+
+    if (!realpath(filename, src)) {
+        ullog_err("unable to open file %s", filename);
+        rc = -1;
+        goto bail;
+    }
+    if ((tree = _tree_load(xmlReaderForFile(src, NULL, 0), filename, src)) == NULL) {
+        rc = -1;
+        goto bail;
+    }
+    // source paths let runs of image notice changed sources
+    if (treeSave(tree, out)) {
+        rc = -1;
+        goto bail;
+    }
+
+    bail:
+    bte_free(tree);
+
+    ullog_debug("exit");
+    return rc;
+}
+
+bte_tree_t *
+bte_load_memory(const char *buf, size_t len)
+{
+    return _tree_load(xmlReaderForMemory(buf, len, "memory.xml", NULL, 0), 
+            "memory.xml", NULL);
+}
+
+void
+bte_free(bte_tree_t *tree)
+{
+    if (!tree) {
+        return;
+    }
+    treeFree(tree);
+    free(tree);
+}
+
+void
+bte_set_output(bte_tree_t *tree, bte_output_cb cb, void *ctx)
+{
+    tree->output_cb = cb;
+    tree->output_ctx = ctx;
+}
+
+void
+bte_set_result(bte_tree_t *tree, bte_result_cb cb, void *ctx)
+{
+    tree->result_cb = cb;
+    tree->result_ctx = ctx;
+}
+
+bte_rc_t
+bte_tick(bte_tree_t *tree, unsigned int budget)
+{
+    rc_t task_rc = tree->state[0].rc;
+    unsigned int i = 0;
+    long long timeout = 0;
+    int ready_n = 0;
+
+    btlog(LOG_TICK, BTELOG_NO_NODE, budget, 0, 0);
+
+    // finished tree keeps its result
+    if (task_rc != RC_RUNNING && task_rc != RC_UNKNOWN) {
+        goto bail;
+    }
+    // tick while some node can make progress without blocking
+    for (i = 0; i < budget || i == 0; ++i) {
+        timeout = reactorTimeout(tree);
+        if ((ready_n = reactorWait(tree, 0)) < 0) {
+            task_rc = RC_ERROR;
+            break;
+        }
+        if (i > 0 && !ready_n && timeout != 0) {
+            break;
+        }
+        task_rc = treeTick(tree);
+        if (task_rc != RC_RUNNING) {
+            break;
+        }
+    }
+
+    bail:
+    if (tree->reaps_n) _stream_reap(tree, 0);
+    treeCheckpointSync(tree, task_rc != RC_RUNNING);
+    btlog(LOG_TICK_RC, BTELOG_NO_NODE, task_rc, 0, 0);
+    return (bte_rc_t) task_rc;
+}
+
+bte_rc_t
+bte_run(bte_tree_t *tree)
+{
+    ullog_debug("enter");
+
+    rc_t task_rc = RC_RUNNING;
+
+    // sleep until some running node can make progress
+    while ((task_rc = (rc_t) bte_tick(tree, 1)) == RC_RUNNING) {
+        if (bte_wait(tree, bte_timeout(tree)) < 0) {
+            task_rc = RC_ERROR;
+        }
+    }
+    ullog_debug("task_rc %s", rc2rstr(task_rc));
+
+    ullog_debug("exit");
+    return (bte_rc_t) task_rc;
+}
+
+int
+bte_wait(bte_tree_t *tree, long long timeout)
+{
+    long long t0 = tree->trace ? _now_ns() : 0;
+    int ready_n = reactorWait(tree, timeout);
+
+    if (tree->trace) _trace_span(tree, TRACE_WAIT, 0, t0, RC_RUNNING);
+    return ready_n < 0 ? -1 : 0;
+}
+
+void
+bte_halt(bte_tree_t *tree)
+{
+    if (tree->state && tree->state[0].rc == RC_RUNNING) {
+        nodeHalt(tree, 0);
+    }
+}
+
+#ifdef __linux__
+/**
+ * \brief   add tree to bottom or top of run queue, ring grows when full
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_rq_push(run_queue_t *rq, pool_item_t *item, int top)
+{
+    pool_item_t **items = NULL;
+    size_t size = 0;
+    size_t i = 0;
+    int rc = 0;
+
+    pthread_mutex_lock(&rq->lock);
+    if (rq->bottom - rq->top == rq->size) {
+        size = rq->size ? rq->size * 2 : 64;
+        if ((items = malloc(size * sizeof(pool_item_t *))) == NULL) {
+            rc = -1;
+            goto bail;
+        }
+        for (i = rq->top; i != rq->bottom; ++i) {
+            items[i & (size - 1)] = rq->items[i & (rq->size - 1)];
+        }
+        free(rq->items);
+        rq->items = items;
+        rq->size = size;
+    }
+    if (top) {
+        rq->items[--rq->top & (rq->size - 1)] = item;
+    } else {
+        rq->items[rq->bottom++ & (rq->size - 1)] = item;
+    }
+
+    bail:
+    pthread_mutex_unlock(&rq->lock);
+    return rc;
+}
+
+/**
+ * \brief   take tree from bottom or top of run queue
+ * \return:
+ *  item - success
+ *  NULL - queue is empty
+ */
+static pool_item_t *
+_rq_pop(run_queue_t *rq, int top)
+{
+    pool_item_t *item = NULL;
+
+    pthread_mutex_lock(&rq->lock);
+    if (rq->bottom != rq->top) {
+        item = top ? rq->items[rq->top++ & (rq->size - 1)] : 
+            rq->items[--rq->bottom & (rq->size - 1)];
+    }
+    pthread_mutex_unlock(&rq->lock);
+    return item;
+}
+
+static void
+_heap_swap(bte_pool_t *pool, unsigned int a, unsigned int b)
+{
+    pool_item_t *item = pool->heap[a];
+
+    pool->heap[a] = pool->heap[b];
+    pool->heap[b] = item;
+    pool->heap[a]->heap_pos = a + 1;
+    pool->heap[b]->heap_pos = b + 1;
+}
+
+/**
+ * \brief   restore order of deadline heap around position, pool lock is held
+ */
+static void
+_heap_fix(bte_pool_t *pool, unsigned int i)
+{
+    unsigned int kid = 0;
+
+    while (i > 0 && pool->heap[i]->deadline < pool->heap[(i - 1) / 2]->deadline) {
+        _heap_swap(pool, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    while ((kid = 2 * i + 1) < pool->heap_n) {
+        if (kid + 1 < pool->heap_n && 
+                pool->heap[kid + 1]->deadline < pool->heap[kid]->deadline) {
+            ++kid;
+        }
+        if (pool->heap[i]->deadline <= pool->heap[kid]->deadline) {
+            break;
+        }
+        _heap_swap(pool, i, kid);
+        i = kid;
+    }
+}
+
+static void
+_heap_remove(bte_pool_t *pool, pool_item_t *item)
+{
+    unsigned int i = item->heap_pos - 1;
+
+    if (!item->heap_pos) {
+        return;
+    }
+    item->heap_pos = 0;
+    if (i != --pool->heap_n) {
+        pool->heap[i] = pool->heap[pool->heap_n];
+        pool->heap[i]->heap_pos = i + 1;
+        _heap_fix(pool, i);
+    }
+}
+
+/**
+ * \brief   put tree into deadline heap or move it there, pool lock is held
+ * \return:
+ *  0 - success
+ *  -1 - error
+ */
+static int
+_heap_set(bte_pool_t *pool, pool_item_t *item, long long deadline)
+{
+    item->deadline = deadline;
+    if (!item->heap_pos) {
+        if (_grow((void **) &pool->heap, &pool->heap_size, pool->heap_n + 1, 
+                    sizeof(pool_item_t *))) {
+            return -1;
+        }
+        pool->heap[pool->heap_n] = item;
+        item->heap_pos = ++pool->heap_n;
+    }
+    _heap_fix(pool, item->heap_pos - 1);
+    return 0;
+}
+
+/**
+ * \brief   take parked tree over, only one worker wins it 
+ *  when its fd and its deadline fire at once
+ * \return:
+ *  1 - tree belongs to caller
+ *  0 - tree is not parked
+ */
+static int
+_pool_claim(pool_item_t *item)
+{
+    unsigned int gen = __atomic_load_n(&item->parked, __ATOMIC_ACQUIRE);
+
+    return (gen & 1) && __atomic_compare_exchange_n(&item->parked, &gen, gen + 1, 
+            0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \brief   claim tree whose event or deadline came, tree being parked 
+ *  right now sees pending flag and claims itself
+ * \return:
+ *  1 - tree belongs to caller
+ *  0 - tree is claimed by other worker or by its parking worker
+ */
+static int
+_pool_claim_event(pool_item_t *item)
+{
+    if (_pool_claim(item)) {
+        return 1;
+    }
+    __atomic_store_n(&item->pending, 1, __ATOMIC_SEQ_CST);
+    return _pool_claim(item);
+}
+
+/**
+ * \brief   give claimed tree that cannot be queued back to deadline heap 
+ *  as due now, pool lock is held
+ */
+static void
+_pool_unclaim(bte_pool_t *pool, pool_item_t *item)
+{
+    ullog_err("cannot queue tree");
+    // heap had room for tree when it was taken out
+    _heap_set(pool, item, _now_ms());
+    __atomic_add_fetch(&item->parked, 1, __ATOMIC_SEQ_CST);
+}
+
+static void
+_pool_wake(bte_pool_t *pool)
+{
+    unsigned long long one = 1;
+
+    if (write(pool->wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        ullog_err("cannot wake pool workers: %s", strerror(errno));
+    }
+}
+
+/**
+ * \brief   park running tree until its fd is ready or its deadline passes, 
+ *  tree without wait goes to top of run queue behind other trees
+ */
+static void
+_pool_park(bte_pool_t *pool, pool_worker_t *w, pool_item_t *item, long long timeout)
+{
+    struct epoll_event ev;
+    int fd = bte_fd(item->tree);
+    int wake = 0;
+    int rc = 0;
+
+    if (timeout == 0) {
+        if (_rq_push(&w->rq, item, 1) == 0) {
+            return;
+        }
+        ullog_err("cannot queue tree");
+        timeout = 1;
+    }
+    pthread_mutex_lock(&pool->lock);
+    if (timeout < 0) {
+        _heap_remove(pool, item);
+    } else if (_heap_set(pool, item, _now_ms() + timeout)) {
+        ullog_err("cannot allocate pool deadline");
+    }
+    wake = item->heap_pos == 1 && pool->idle;
+    pthread_mutex_unlock(&pool->lock);
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = item;
+    rc = epoll_ctl(pool->epfd, item->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+    if (rc) {
+        ullog_err("cannot park tree in pool epoll: %s", strerror(errno));
+    }
+    item->registered = 1;
+    // tree may be claimed once parked, event seen before is claimed here
+    __atomic_add_fetch(&item->parked, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&item->pending, 0, __ATOMIC_SEQ_CST) && _pool_claim(item)) {
+        pthread_mutex_lock(&pool->lock);
+        _heap_remove(pool, item);
+        if (_rq_push(&w->rq, item, 0)) {
+            _pool_unclaim(pool, item);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (wake) {
+        _pool_wake(pool);
+    }
+}
+
+/**
+ * \brief   claim trees whose deadline passed or fd is ready, 
+ *  worker sleeps in pool epoll when there are none
+ */
+static void
+_pool_idle(bte_pool_t *pool, pool_worker_t *w)
+{
+    struct epoll_event events[POOL_MAX_EVENTS];
+    pool_item_t *item = NULL;
+    long long timeout = -1;
+    long long now = 0;
+    unsigned long long val = 0;
+    int claimed = 0;
+    int n = 0;
+    int i = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    now = _now_ms();
+    while (pool->heap_n && pool->heap[0]->deadline <= now) {
+        item = pool->heap[0];
+        _heap_remove(pool, item);
+        if (!_pool_claim_event(item)) {
+            continue;
+        }
+        if (_rq_push(&w->rq, item, 0)) {
+            _pool_unclaim(pool, item);
+            break;
+        }
+        ++claimed;
+    }
+    if (pool->heap_n) {
+        timeout = pool->heap[0]->deadline - now;
+    }
+    if (!claimed) {
+        __atomic_add_fetch(&pool->idle, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    if (claimed) {
+        goto bail;
+    }
+
+    n = epoll_wait(pool->epfd, events, POOL_MAX_EVENTS, (int) timeout);
+    if (n < 0 && errno != EINTR) {
+        ullog_err("pool epoll wait failed: %s", strerror(errno));
+    }
+    pthread_mutex_lock(&pool->lock);
+    __atomic_sub_fetch(&pool->idle, 1, __ATOMIC_RELAXED);
+    for (i = 0; i < n; ++i) {
+        if ((item = events[i].data.ptr) == NULL) {
+            // stopping pool keeps waking all workers
+            if (!__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE) && 
+                    read(pool->wakefd, &val, sizeof(val)) < 0) {
+                continue;
+            }
+        } else {
+            if (!_pool_claim_event(item)) {
+                continue;
+            }
+            _heap_remove(pool, item);
+            if (_rq_push(&w->rq, item, 0)) {
+                _pool_unclaim(pool, item);
+            } else {
+                ++claimed;
+            }
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    bail:
+    // others steal what this worker cannot run soon
+    if (claimed > 1 && __atomic_load_n(&pool->idle, __ATOMIC_RELAXED)) {
+        _pool_wake(pool);
+    }
+}
+
+/**
+ * \brief   tick tree claimed by worker, finished tree is handed back 
+ *  to its owner by done callback
+ */
+static void
+_pool_run(bte_pool_t *pool, pool_worker_t *w, pool_item_t *item)
+{
+    bte_rc_t rc = bte_tick(item->tree, POOL_TICK_BUDGET);
+
+    if (rc == BTE_RUNNING) {
+        _pool_park(pool, w, item, bte_timeout(item->tree));
+        return;
+    }
+    if (item->registered) {
+        epoll_ctl(pool->epfd, EPOLL_CTL_DEL, bte_fd(item->tree), NULL);
+    }
+    if (item->cb) {
+        item->cb(item->ctx, item->tree, rc);
+    }
+    pthread_mutex_lock(&pool->lock);
+    item->tree = NULL;
+    item->next = pool->free_items;
+    pool->free_items = item;
+    if (--pool->active == 0) {
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *
+_pool_worker(void *arg)
+{
+    pool_worker_t *w = arg;
+    bte_pool_t *pool = w->pool;
+    pool_item_t *item = NULL;
+    unsigned int i = 0;
+
+    while (!__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) {
+        // own trees newest first, others oldest first
+        item = _rq_pop(&w->rq, 0);
+        for (i = 1; !item && i < pool->workers_n; ++i) {
+            item = _rq_pop(&pool->workers[(w->id + i) % pool->workers_n].rq, 1);
+        }
+        if (item) {
+            _pool_run(pool, w, item);
+        } else {
+            _pool_idle(pool, w);
+        }
+    }
+    // wake of stop may be read by this worker only, pass it on
+    _pool_wake(pool);
+    return NULL;
+}
+#endif
+
+bte_pool_t *
+bte_pool_new(unsigned int threads)
+{
+#ifdef __linux__
+    bte_pool_t *pool = NULL;
+    struct epoll_event ev;
+    long cpus = 0;
+    unsigned int i = 0;
+
+    if (!threads) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned int) cpus : 1;
+    }
+    if ((pool = calloc(1, sizeof(bte_pool_t))) == NULL || 
+            (pool->workers = calloc(threads, sizeof(pool_worker_t))) == NULL) {
+        ullog_err("cannot allocate pool");
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if ((pool->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0 || 
+            (pool->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 || 
+            epoll_ctl(pool->epfd, EPOLL_CTL_ADD, pool->wakefd, &ev)) {
+        ullog_err("cannot create pool epoll: %s", strerror(errno));
+        bte_pool_free(pool);
+        return NULL;
+    }
+    pool->workers_n = threads;
+    for (i = 0; i < threads; ++i) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        pthread_mutex_init(&pool->workers[i].rq.lock, NULL);
+    }
+    for (i = 0; i < threads; ++i) {
+        if (pthread_create(&pool->workers[i].thread, NULL, _pool_worker, 
+                    &pool->workers[i])) {
+            ullog_err("cannot start pool worker %u", i);
+            bte_pool_free(pool);
+            return NULL;
+        }
+        pool->started = i + 1;
+    }
+    return pool;
+#else
+    ullog_err("pool is not supported on this system");
+    return NULL;
+#endif
+}
+
+int
+bte_pool_submit(bte_pool_t *pool, bte_tree_t *tree, bte_done_cb cb, void *ctx)
+{
+#ifdef __linux__
+    pool_item_t *item = NULL;
+    unsigned int w = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    if ((item = pool->free_items) != NULL) {
+        pool->free_items = item->next;
+    } else if ((item = calloc(1, sizeof(pool_item_t))) == NULL) {
+        pthread_mutex_unlock(&pool->lock);
+        ullog_err("cannot allocate pool item");
+        return -1;
+    }
+    item->tree = tree;
+    item->cb = cb;
+    item->ctx = ctx;
+    item->registered = 0;
+    item->next = NULL;
+    w = pool->next++ % pool->workers_n;
+    ++pool->active;
+    pthread_mutex_unlock(&pool->lock);
+    if (_rq_push(&pool->workers[w].rq, item, 0)) {
+        ullog_err("cannot queue tree");
+        pthread_mutex_lock(&pool->lock);
+        item->next = pool->free_items;
+        pool->free_items = item;
+        if (--pool->active == 0) {
+            pthread_cond_broadcast(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return -1;
+    }
+    _pool_wake(pool);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+void
+bte_pool_wait(bte_pool_t *pool)
+{
+#ifdef __linux__
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+void
+bte_pool_free(bte_pool_t *pool)
+{
+#ifdef __linux__
+    pool_item_t *item = NULL;
+    unsigned int i = 0;
+
+    if (!pool) {
+        return;
+    }
+    bte_pool_wait(pool);
+    __atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+    if (pool->wakefd > 0) {
+        _pool_wake(pool);
+    }
+    for (i = 0; i < pool->started; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (i = 0; pool->workers && i < pool->workers_n; ++i) {
+        free(pool->workers[i].rq.items);
+        pthread_mutex_destroy(&pool->workers[i].rq.lock);
+    }
+    if (pool->epfd > 0) close(pool->epfd);
+    if (pool->wakefd > 0) close(pool->wakefd);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->done);
+    while ((item = pool->free_items) != NULL) {
+        pool->free_items = item->next;
+        free(item);
+    }
+    free(pool->heap);
+    free(pool->workers);
+    free(pool);
+#endif
+}
+
+int
+bte_fd(bte_tree_t *tree)
+{
+    return tree->reactor.epfd;
+}
+
+unsigned int
+bte_pollfds(bte_tree_t *tree, struct pollfd *pfds, unsigned int n)
+{
+    reactor_t *reactor = &tree->reactor;
+    unsigned int i = 0;
+
+    for (i = 0; i < reactor->waits_n && i < n; ++i) {
+        pfds[i].fd = reactor->waits[i].fd;
+        pfds[i].events = ((reactor->waits[i].events & IO_READ) ? POLLIN : 0) | 
+            ((reactor->waits[i].events & IO_WRITE) ? POLLOUT : 0);
+        pfds[i].revents = 0;
+    }
+    return reactor->waits_n;
+}
+
+long long
+bte_timeout(bte_tree_t *tree)
+{
+    long long timeout = reactorTimeout(tree);
+    long long sync = 0;
+    unsigned int i = 0;
+
+    // tick syncs checkpoint records even when no node wakes up
+    if (tree->ckpt && tree->ckpt_unsynced) {
+        sync = tree->ckpt_sync + CKPT_SYNC_MS - _now_ms();
+        if (sync < 0) sync = 0;
+        if (timeout < 0 || sync < timeout) timeout = sync;
+    }
+    // and signals processes of closed streams on time
+    for (i = 0; i < tree->reaps_n; ++i) {
+        sync = tree->reaps[i].deadline - _now_ms();
+        if (sync < 0) sync = 0;
+        if (timeout < 0 || sync < timeout) timeout = sync;
+    }
+    return timeout;
+}
+
+int
+bte_save_state(bte_tree_t *tree, const char *filename)
+{
+    ullog_debug("dump node states to %s", filename);
+    if (treeSaveState(tree, filename)) {
+        ullog_err("unable to write node states to %s", filename);
+        return -1;
+    }
+    return 0;
+}
+
+int
+bte_set_checkpoint(bte_tree_t *tree, const char *filename, int resume)
+{
+    ullog_debug("checkpoint to %s resume %d", filename, resume);
+    if (treeCheckpoint(tree, filename, resume)) {
+        ullog_err("unable to start checkpoint %s", filename);
+        return -1;
+    }
+    return 0;
+}
+
+int
+bte_set_trace(bte_tree_t *tree, size_t events)
+{
+    trace_event_t *trace = NULL;
+
+    if (events && (trace = calloc(events, sizeof(trace_event_t))) == NULL) {
+        ullog_err("cannot allocate trace of %zu events", events);
+        return -1;
+    }
+    if (tree->trace) free(tree->trace);
+    tree->trace = trace;
+    tree->trace_size = events;
+    tree->trace_n = 0;
+    return 0;
+}
+
+/**
+ * \brief   write string as json string
+ */
+static void
+_json_str(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\') {
+            fprintf(fp, "\\%c", *str);
+        } else if ((unsigned char) *str < 0x20) {
+            fprintf(fp, "\\u%04x", (unsigned char) *str);
+        } else {
+            fputc(*str, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+int
+bte_save_trace(bte_tree_t *tree, const char *filename)
+{
+    FILE *fp = NULL;
+    const trace_event_t *ev = NULL;
+    const bt_node_t *n = NULL;
+    const char *kind = NULL;
+    unsigned long long first = 0;
+    unsigned long long i = 0;
+    int pid = (int) getpid();
+
+    if (!tree->trace) {
+        ullog_err("tree is not traced");
+        return -1;
+    }
+    if ((fp = fopen(filename, "w")) == NULL) {
+        ullog_err("cannot create %s: %s", filename, strerror(errno));
+        return -1;
+    }
+    // chrome trace event format, times in microseconds
+    fprintf(fp, "{\"traceEvents\":[");
+    first = tree->trace_n > tree->trace_size ? tree->trace_n - tree->trace_size : 0;
+    for (i = first; i < tree->trace_n; ++i) {
+        ev = &tree->trace[i % tree->trace_size];
+        n = NODE(tree, ev->node);
+        kind = n->kind == NODE_ACTION ? action_kind_str[n->action] : node_kind_str[n->kind];
+        fprintf(fp, "%s\n{\"name\":", i == first ? "" : ",");
+        if (ev->what == TRACE_NODE || ev->what == TRACE_STATE) {
+            _json_str(fp, n->id ? NODE_STR(tree, n->id) : kind);
+        } else {
+            _json_str(fp, trace_what_str[ev->what]);
+        }
+        fprintf(fp, ",\"cat\":\"%s\",\"pid\":%d,\"tid\":1,\"ts\":%.3f,", 
+                trace_what_str[ev->what], pid, ev->ts / 1e3);
+        if (ev->what == TRACE_STATE) {
+            fprintf(fp, "\"ph\":\"i\",\"s\":\"t\",");
+        } else {
+            fprintf(fp, "\"ph\":\"X\",\"dur\":%.3f,", ev->dur / 1e3);
+        }
+        fprintf(fp, "\"args\":{\"node\":%u,\"kind\":\"%s\",\"rc\":\"%s\"", 
+                ev->node, kind, bte_rc_str((bte_rc_t) ev->rc));
+        if (ev->what == TRACE_STATE) {
+            fprintf(fp, ",\"from\":\"%s\"", bte_rc_str((bte_rc_t) ev->prev_rc));
+        }
+        fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    if (fclose(fp)) {
+        ullog_err("cannot write %s: %s", filename, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void
+bte_set_log_level(bte_log_level_t level)
+{
+    __atomic_store_n(&g_log_level, level, __ATOMIC_RELAXED);
+}
+
+int
+bte_save_log(const char *filename)
+{
+    FILE *fp = NULL;
+    const log_ring_t *ring = NULL;
+    btelog_header_t hdr;
+    unsigned long long head = 0;
+    unsigned long long first = 0;
+    unsigned long long i = 0;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BTELOG_MAGIC, sizeof(hdr.magic));
+    hdr.version = BTELOG_VERSION;
+    hdr.rec_size = sizeof(btelog_rec_t);
+    hdr.formats_n = LOG_FORMATS_N;
+    if ((fp = fopen(filename, "w")) == NULL) {
+        ullog_err("cannot create %s: %s", filename, strerror(errno));
+        return -1;
+    }
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    // rings are never freed, records added while writing may come out torn
+    ring = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE);
+    for (; ring; ring = ring->next) {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        first = head > LOG_RING_SIZE ? head - LOG_RING_SIZE : 0;
+        for (i = first; i < head; ++i) {
+            fwrite(&ring->recs[i & (LOG_RING_SIZE - 1)], sizeof(btelog_rec_t), 1, fp);
+        }
+        hdr.recs_n += head - first;
+    }
+    // header is rewritten with count of records
+    rewind(fp);
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    if (ferror(fp) | fclose(fp)) {
+        ullog_err("cannot write %s: %s", filename, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void
+bte_print_stats(bte_tree_t *tree, long long run_ns)
+{
+    treeStats(tree, run_ns);
+}
+
+void
+bte_set_debug(int enable)
+{
+    g_debug = enable;
+}
+
+void
+bte_set_stats(int enable)
+{
+    g_stats = enable;
+}
+
+const char *
+bte_rc_str(bte_rc_t rc)
+{
+    const char *str = rc2rstr(rc);
+
+    return str ? str : "unknown";
+}
+
+long long
+bte_now_ns(void)
+{
+    return _now_ns();
+}
+
+void
+bte_cleanup(void)
+{
+    exec_cache_t *item = NULL;
+    exec_cache_t *tmp = NULL;
+
+    pthread_mutex_lock(&g_exec_cache_lock);
+    HASH_ITER(hh, g_exec_cache, item, tmp) {
+        _exec_cache_drop(item, item->hh.keylen);
+    }
+    pthread_mutex_unlock(&g_exec_cache_lock);
+    xmlCleanupParser();
+}
+
+// EOF
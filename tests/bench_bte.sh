@@ -0,0 +1,82 @@
+# benchmarks of tick loop, actions and streams
+# generated trees go to temporary directory, bte prints statistics with -S
+
+BTE_CMD=../src/bte
+BENCH_DIR=${TMPDIR:-/tmp}/bte_bench.$$
+N_DEEP=${N_DEEP:-250} # libxml refuses deeper documents
+N_WIDE=${N_WIDE:-10000}
+N_EXEC=${N_EXEC:-1000}
+N_PAR=${N_PAR:-200}
+N_SEQ=${N_SEQ:-200000}
+N_WRITE_KB=${N_WRITE_KB:-1024}
+
+mkdir -p $BENCH_DIR || exit 1
+trap 'rm -rf $BENCH_DIR' EXIT
+
+# deep sequence ending with succeeded empty action
+awk -v n=$N_DEEP 'BEGIN {
+	print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<bt>"
+	for (i = 0; i < n; i++) print "<sequence>"
+	print "<decorator type=\"succeeder\"><action/></decorator>"
+	for (i = 0; i < n; i++) print "</sequence>"
+	print "</bt>"
+}' > $BENCH_DIR/deep_bt.xml
+
+# wide select of failing empty actions
+awk -v n=$N_WIDE 'BEGIN {
+	print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<bt>\n<decorator type=\"succeeder\"><select>"
+	for (i = 0; i < n; i++) print "<action/>"
+	print "</select></decorator>\n</bt>"
+}' > $BENCH_DIR/wide_bt.xml
+
+# many short exec leaves one after another
+awk -v n=$N_EXEC 'BEGIN {
+	print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<bt>\n<sequence>"
+	for (i = 0; i < n; i++) print "<action><exec>true</exec></action>"
+	print "</sequence>\n</bt>"
+}' > $BENCH_DIR/exec_bt.xml
+
+# many short exec leaves at once
+awk -v n=$N_PAR 'BEGIN {
+	print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<bt>\n<parallel>"
+	for (i = 0; i < n; i++) print "<action><exec>true</exec></action>"
+	print "</parallel>\n</bt>"
+}' > $BENCH_DIR/par_bt.xml
+
+# chatty pty peer matched by literal and glob patterns
+cat > $BENCH_DIR/expect_lit_bt.xml <<EOT
+<?xml version="1.0" encoding="UTF-8"?>
+<bt><sequence>
+<action><open stream_id="seq" settle="none">seq 1 $N_SEQ</open></action>
+<action><expect stream_id="seq">$N_SEQ</expect></action>
+<action><close stream_id="seq"/></action>
+</sequence></bt>
+EOT
+sed "s@>$N_SEQ</expect>@>*$N_SEQ?</expect>@" $BENCH_DIR/expect_lit_bt.xml > $BENCH_DIR/expect_glob_bt.xml
+
+# raw pty peer swallowing written payload
+cat > $BENCH_DIR/sink.sh <<EOT
+stty raw -echo
+echo ready
+exec cat > /dev/null
+EOT
+awk -v n=$N_WRITE_KB -v dir=$BENCH_DIR 'BEGIN {
+	print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<bt><sequence>"
+	print "<action><open stream_id=\"sink\" settle=\"none\">sh " dir "/sink.sh</open></action>"
+	print "<action><expect stream_id=\"sink\">ready</expect></action>"
+	printf "<action><write stream_id=\"sink\" settle=\"none\">"
+	for (i = 0; i < n * 16; i++) printf "%063d\\n", i
+	print "</write></action>"
+	print "<action><close stream_id=\"sink\"/></action>"
+	print "</sequence></bt>"
+}' > $BENCH_DIR/write_bt.xml
+
+rc=0
+for t in deep wide exec par expect_lit expect_glob write ; do
+	echo "== $t"
+	if ! $BTE_CMD -S $BENCH_DIR/${t}_bt.xml 2>&1 >/dev/null | grep "^stats:" ; then
+		echo "failed: bench $t"
+		rc=1
+	fi
+done
+exit $rc
@@ -0,0 +1,3 @@
+# stream peer which ignores hangup of its pty
+trap "" HUP
+exec sleep 10
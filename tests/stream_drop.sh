@@ -0,0 +1,6 @@
+# stream peer printing xyz after first half of expect buffer, 
+# total output makes expect drop that half once
+head -c 1024 /dev/zero | tr '\0' '.'
+printf 'xyz'
+head -c 1500 /dev/zero | tr '\0' '.'
+sleep 5
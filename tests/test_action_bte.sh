@@ -89,3 +89,15 @@ fi
 rm -f out
 echo "ok one big action"
 
+
+echo "one ok split text action"
+if ! r=`$BTE_CMD test_one_ok_split_text_action_bt.xml 2>&1` ; then
+	echo "failed: one ok split text action"
+	exit 1
+fi
+m="Hi"
+if [ "$r" != "$m" ]; then
+	echo "failed: output of one ok split text action"
+	exit 1
+fi
+echo "ok one ok split text action"
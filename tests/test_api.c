@@ -0,0 +1,251 @@
+/*
+ * test of libbte api: tree is driven by own poll loop of caller
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <time.h>
+
+#include "bte.h"
+
+#define MAX_FDS 16
+#define POOL_TREES 32
+#define POOL_THREADS 4
+
+static const char *g_tree = 
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<bt>\n"
+    "  <action id='w_0' type='cmd' os='unix'>\n"
+    "    <exec>echo Hi</exec>\n"
+    "  </action>\n"
+    "</bt>\n";
+
+// actions without id are named by node ordinal
+static const char *g_anon_tree = 
+    "<bt><sequence>"
+    "<action><exec>true</exec></action>"
+    "<action><exec>true</exec></action>"
+    "</sequence></bt>";
+
+// sleep lets trees park and get picked by other workers, 
+// short backoffs park trees on deadline only
+static const char *g_pool_tree = 
+    "<bt><sequence>"
+    "<action><exec>sleep 0.05</exec></action>"
+    "<decorator type='succeeder'>"
+    "<decorator type='retry' count='4' backoff_ms='1'>"
+    "<action><exec>false</exec></action>"
+    "</decorator></decorator>"
+    "<action><exec>echo Hi</exec></action>"
+    "</sequence></bt>";
+
+// closed stream process ignores hangup, worker closing it 
+// must go on with other trees
+static const char *g_hup_tree = 
+    "<bt><sequence>"
+    "<action><open stream_id='hup'>sh hup_ignore.sh</open></action>"
+    "<action><close stream_id='hup'></close></action>"
+    "</sequence></bt>";
+
+static const char *g_slow_tree = 
+    "<bt><sequence>"
+    "<action><exec>sleep 1.5</exec></action>"
+    "<action><exec>echo Hi</exec></action>"
+    "</sequence></bt>";
+
+typedef struct {
+    char out[256];
+    size_t out_n;
+    unsigned int results;
+    bte_rc_t last_rc;
+    char ids[64]; // finished node ids separated by comma
+    long long done_ms; // monotonic ms tree finished at
+} capture_t;
+
+static long long
+_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+_output(void *ctx, const char *buf, size_t len)
+{
+    capture_t *cap = ctx;
+
+    if (cap->out_n + len < sizeof(cap->out)) {
+        memcpy(cap->out + cap->out_n, buf, len);
+        cap->out_n += len;
+    }
+}
+
+static void
+_result(void *ctx, const char *node_id, bte_rc_t rc)
+{
+    capture_t *cap = ctx;
+
+    ++cap->results;
+    cap->last_rc = rc;
+    if (strlen(cap->ids) + strlen(node_id) + 2 < sizeof(cap->ids)) {
+        strcat(cap->ids, node_id);
+        strcat(cap->ids, ",");
+    }
+}
+
+static void
+_done(void *ctx, bte_tree_t *tree, bte_rc_t rc)
+{
+    capture_t *cap = ctx;
+
+    cap->last_rc = rc;
+    cap->done_ms = _now_ms();
+}
+
+static bte_rc_t
+_run(bte_tree_t *tree)
+{
+    bte_rc_t rc = BTE_RUNNING;
+    struct pollfd pfds[MAX_FDS];
+    unsigned int n = 0;
+
+    while ((rc = bte_tick(tree, 8)) == BTE_RUNNING) {
+        n = bte_pollfds(tree, pfds, MAX_FDS);
+        if (poll(pfds, n < MAX_FDS ? n : MAX_FDS, (int) bte_timeout(tree)) < 0) {
+            return BTE_ERROR;
+        }
+    }
+    return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+    bte_tree_t *tree = NULL;
+    bte_rc_t rc = BTE_RUNNING;
+    capture_t cap;
+    capture_t caps[POOL_TREES];
+    bte_tree_t *trees[POOL_TREES];
+    bte_pool_t *pool = NULL;
+    unsigned int i = 0;
+    long long t0 = 0;
+
+    memset(&cap, 0, sizeof(cap));
+
+    printf("load bad xml\n");
+    if (bte_load_memory("<bt><action>", 12) != NULL) {
+        printf("failed: bad xml is loaded\n");
+        return 1;
+    }
+    printf("ok load bad xml\n");
+
+    printf("run tree in own loop\n");
+    if ((tree = bte_load_memory(g_tree, strlen(g_tree))) == NULL) {
+        printf("failed: load tree\n");
+        return 1;
+    }
+    bte_set_output(tree, _output, &cap);
+    bte_set_result(tree, _result, &cap);
+    rc = _run(tree);
+    bte_free(tree);
+    if (rc != BTE_SUCCESS) {
+        printf("failed: tree rc %s\n", bte_rc_str(rc));
+        return 1;
+    }
+    if (cap.out_n != 3 || memcmp(cap.out, "Hi\n", 3) != 0) {
+        printf("failed: output '%.*s'\n", (int) cap.out_n, cap.out);
+        return 1;
+    }
+    if (cap.results == 0 || cap.last_rc != BTE_SUCCESS) {
+        printf("failed: results %u last rc %s\n", cap.results, 
+                bte_rc_str(cap.last_rc));
+        return 1;
+    }
+    printf("ok run tree in own loop\n");
+
+    printf("node ids without id attribute\n");
+    for (i = 0; i < 2; ++i) {
+        memset(&cap, 0, sizeof(cap));
+        if ((tree = bte_load_memory(g_anon_tree, strlen(g_anon_tree))) == NULL) {
+            printf("failed: load tree\n");
+            return 1;
+        }
+        bte_set_result(tree, _result, &cap);
+        rc = _run(tree);
+        bte_free(tree);
+        if (rc != BTE_SUCCESS || strcmp(cap.ids, "2,3,,,") != 0) {
+            printf("failed: run %u rc %s ids '%s'\n", i, bte_rc_str(rc), cap.ids);
+            return 1;
+        }
+    }
+    printf("ok node ids without id attribute\n");
+
+    printf("run trees on pool\n");
+    if ((pool = bte_pool_new(POOL_THREADS)) == NULL) {
+        printf("failed: pool\n");
+        return 1;
+    }
+    memset(caps, 0, sizeof(caps));
+    for (i = 0; i < POOL_TREES; ++i) {
+        caps[i].last_rc = BTE_RUNNING;
+        if ((trees[i] = bte_load_memory(g_pool_tree, strlen(g_pool_tree))) == NULL) {
+            printf("failed: load tree %u\n", i);
+            return 1;
+        }
+        bte_set_output(trees[i], _output, &caps[i]);
+        if (bte_pool_submit(pool, trees[i], _done, &caps[i])) {
+            printf("failed: submit tree %u\n", i);
+            return 1;
+        }
+    }
+    bte_pool_wait(pool);
+    bte_pool_free(pool);
+    for (i = 0; i < POOL_TREES; ++i) {
+        bte_free(trees[i]);
+        if (caps[i].last_rc != BTE_SUCCESS || caps[i].out_n != 3 || 
+                memcmp(caps[i].out, "Hi\n", 3) != 0) {
+            printf("failed: tree %u rc %s output '%.*s'\n", i, 
+                    bte_rc_str(caps[i].last_rc), (int) caps[i].out_n, caps[i].out);
+            return 1;
+        }
+    }
+    printf("ok run trees on pool\n");
+
+    printf("pool worker next to stream ignoring hangup\n");
+    if ((pool = bte_pool_new(1)) == NULL) {
+        printf("failed: pool\n");
+        return 1;
+    }
+    memset(caps, 0, sizeof(caps));
+    if ((trees[0] = bte_load_memory(g_hup_tree, strlen(g_hup_tree))) == NULL || 
+            (trees[1] = bte_load_memory(g_slow_tree, strlen(g_slow_tree))) == NULL) {
+        printf("failed: load tree\n");
+        return 1;
+    }
+    bte_set_output(trees[1], _output, &caps[1]);
+    t0 = _now_ms();
+    if (bte_pool_submit(pool, trees[0], _done, &caps[0]) || 
+            bte_pool_submit(pool, trees[1], _done, &caps[1])) {
+        printf("failed: submit tree\n");
+        return 1;
+    }
+    bte_pool_wait(pool);
+    bte_pool_free(pool);
+    bte_free(trees[0]);
+    bte_free(trees[1]);
+    if (caps[0].last_rc != BTE_SUCCESS || caps[1].last_rc != BTE_SUCCESS || 
+            caps[1].done_ms - t0 > 4000) {
+        printf("failed: rc %s %s slow tree done after %lld ms\n", 
+                bte_rc_str(caps[0].last_rc), bte_rc_str(caps[1].last_rc), 
+                caps[1].done_ms - t0);
+        return 1;
+    }
+    printf("ok pool worker next to stream ignoring hangup\n");
+
+    bte_cleanup();
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+BTE_CMD=../src/bte
+BIN_DIR=${TMPDIR:-/tmp}/bte_bin.$$
+
+mkdir -p $BIN_DIR || exit 1
+trap 'rm -rf $BIN_DIR' EXIT
+
+echo "compile one ok action"
+cp test_one_ok_action_bt.xml $BIN_DIR/one_ok_bt.xml
+if ! $BTE_CMD compile $BIN_DIR/one_ok_bt.xml ; then
+	echo "failed: compile one ok action"
+	exit 1
+fi
+if ! r=`$BTE_CMD $BIN_DIR/one_ok_bt.bteb 2>&1` || [ "$r" != "Hi" ]; then
+	echo "failed: run of binary one ok action"
+	exit 1
+fi
+echo "ok compile one ok action"
+
+echo "compile expect glob"
+if ! $BTE_CMD compile test_stream_expect_glob_bt.xml -o $BIN_DIR/glob.bteb ; then
+	echo "failed: compile expect glob"
+	exit 1
+fi
+if ! $BTE_CMD $BIN_DIR/glob.bteb > /dev/null ; then
+	echo "failed: run of binary expect glob"
+	exit 1
+fi
+echo "ok compile expect glob"
+
+echo "stale binary falls back to xml"
+sleep 1
+sed 's/echo Hi/echo Changed/' test_one_ok_action_bt.xml > $BIN_DIR/one_ok_bt.xml
+if ! r=`$BTE_CMD $BIN_DIR/one_ok_bt.bteb 2>&1` || [ "$r" != "Changed" ]; then
+	echo "failed: stale binary falls back to xml"
+	exit 1
+fi
+echo "ok stale binary falls back to xml"
+
+echo "changed subtree file makes binary stale"
+cp test_subtree_bt.xml test_subtree_lib_bt.xml $BIN_DIR/
+if ! $BTE_CMD compile $BIN_DIR/test_subtree_bt.xml > /dev/null || 
+		! $BTE_CMD $BIN_DIR/test_subtree_bt.bteb > /dev/null ; then
+	echo "failed: compile subtree"
+	exit 1
+fi
+# same size, mtime differs however fast test runs
+sed "s/<match data='word'>hello</<match data='word'>hallo</" \
+	test_subtree_lib_bt.xml > $BIN_DIR/test_subtree_lib_bt.xml
+touch -d '2000-01-01' $BIN_DIR/test_subtree_lib_bt.xml
+if $BTE_CMD $BIN_DIR/test_subtree_bt.bteb > /dev/null 2>&1 ; then
+	echo "failed: changed subtree file makes binary stale"
+	exit 1
+fi
+echo "ok changed subtree file makes binary stale"
+
+echo "not truncated binary"
+head -c 200 $BIN_DIR/glob.bteb > $BIN_DIR/short.bteb
+if $BTE_CMD $BIN_DIR/short.bteb ; then
+	echo "failed: not truncated binary"
+	exit 1
+fi
+echo "ok not truncated binary"
+
+echo "not compile bad xml"
+if $BTE_CMD compile test_bad_xml.xml -o $BIN_DIR/bad.bteb ; then
+	echo "failed: not compile bad xml"
+	exit 1
+fi
+echo "ok not compile bad xml"
+
+echo "state dump of binary"
+$BTE_CMD compile test_one_ok_action_bt.xml -o $BIN_DIR/state.bteb
+if ! $BTE_CMD -s $BIN_DIR/state_out.xml $BIN_DIR/state.bteb > /dev/null ; then
+	echo "failed: state dump of binary"
+	exit 1
+fi
+if ! grep -q "<exec _state_=\"success\">echo Hi</exec>" $BIN_DIR/state_out.xml ; then
+	echo "failed: output of state dump of binary"
+	exit 1
+fi
+echo "ok state dump of binary"
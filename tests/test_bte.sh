@@ -23,6 +23,12 @@ if ! sh test_sel_bte.sh ; then
 	exit 1
 fi
 
+echo "testing parallel"
+if ! sh test_par_bte.sh ; then
+	echo "par failed"
+	exit 1
+fi
+
 echo "testing decorator succeeder"
 if ! sh test_decorator_succeeder_bte.sh ; then
 	echo "decorator succeeder failed"
@@ -35,3 +41,63 @@ if ! sh test_stream_bte.sh ; then
 	echo "test stream failed"
 	exit 1
 fi
+
+echo "testing variables"
+if ! sh test_var_bte.sh ; then
+	echo "test variables failed"
+	exit 1
+fi
+
+echo "testing subtrees"
+if ! sh test_subtree_bte.sh ; then
+	echo "test subtrees failed"
+	exit 1
+fi
+
+echo "testing timeouts"
+if ! sh test_timeout_bte.sh ; then
+	echo "test timeouts failed"
+	exit 1
+fi
+
+echo "testing retries"
+if ! sh test_retry_bte.sh ; then
+	echo "test retries failed"
+	exit 1
+fi
+
+echo "testing exec cache"
+if ! sh test_cache_bte.sh ; then
+	echo "test exec cache failed"
+	exit 1
+fi
+
+echo "testing checkpoint"
+if ! sh test_ckpt_bte.sh ; then
+	echo "test checkpoint failed"
+	exit 1
+fi
+
+echo "testing pool"
+if ! sh test_pool_bte.sh ; then
+	echo "test pool failed"
+	exit 1
+fi
+
+echo "testing serve"
+if ! sh test_serve_bte.sh ; then
+	echo "test serve failed"
+	exit 1
+fi
+
+echo "testing binary"
+if ! sh test_bin_bte.sh ; then
+	echo "test binary failed"
+	exit 1
+fi
+
+echo "testing api"
+if ! ./test_api ; then
+	echo "test api failed"
+	exit 1
+fi
@@ -0,0 +1,28 @@
+BTE_CMD=../src/bte
+
+echo "test cache"
+rm -f cache.cnt
+if ! r=`$BTE_CMD -S test_cache_bt.xml 2> cache.err` ; then
+	rm -f cache.cnt cache.err
+	echo "failed: test cache"
+	exit 1
+fi
+hits=`sed -n 's/.* cache_hits \([0-9]*\)$/\1/p' cache.err`
+cnt=`cat cache.cnt`
+rm -f cache.cnt cache.err
+if [ `echo "$r" | grep -c "^up$"` -ne 3 ] || [ "$hits" != "4" ] || 
+		[ `echo "$cnt" | grep -c "^probe$"` -ne 1 ] || 
+		[ `echo "$cnt" | grep -c "^down$"` -ne 1 ] || 
+		[ `echo "$cnt" | grep -c "^expired$"` -ne 2 ] || 
+		[ `echo "$cnt" | grep -c "^big$"` -ne 2 ] ; then
+	echo "failed: output of test cache"
+	exit 1
+fi
+echo "ok test cache"
+
+echo "test cache bad"
+if r=`$BTE_CMD test_cache_bad_bt.xml` ; then
+	echo "failed: test cache bad"
+	exit 1
+fi
+echo "ok test cache bad"
@@ -0,0 +1,55 @@
+BTE_CMD=../src/bte
+
+echo "test checkpoint"
+rm -f ckpt.cnt ckpt.go ckpt.btec
+if $BTE_CMD -c ckpt.btec test_ckpt_bt.xml ; then
+	rm -f ckpt.cnt ckpt.btec
+	echo "failed: test checkpoint"
+	exit 1
+fi
+touch ckpt.go
+if ! $BTE_CMD -c ckpt.btec --resume test_ckpt_bt.xml || 
+		! $BTE_CMD -c ckpt.btec --resume test_ckpt_bt.xml ; then
+	rm -f ckpt.cnt ckpt.go ckpt.btec
+	echo "failed: test checkpoint resume"
+	exit 1
+fi
+r=`sort ckpt.cnt | uniq -c | awk '{ print $2 $1 }' | tr '\n' ' '`
+rm -f ckpt.cnt ckpt.go
+if [ "$r" != "a1 b1 capture1 never1 once1 " ] ; then
+	rm -f ckpt.btec
+	echo "failed: output of test checkpoint: $r"
+	exit 1
+fi
+echo "ok test checkpoint"
+
+echo "test checkpoint of other tree"
+if $BTE_CMD -c ckpt.btec --resume test_one_ok_action_bt.xml > /dev/null ; then
+	rm -f ckpt.btec
+	echo "failed: test checkpoint of other tree"
+	exit 1
+fi
+rm -f ckpt.btec
+echo "ok test checkpoint of other tree"
+
+echo "test checkpoint crash"
+$BTE_CMD -c ckpt.btec test_ckpt_crash_bt.xml &
+pid=$!
+sleep 1
+kill -9 $pid
+wait $pid 2> /dev/null
+# torn record at end is dropped
+printf 'torn' >> ckpt.btec
+touch ckpt.go
+if ! $BTE_CMD -c ckpt.btec --resume test_ckpt_crash_bt.xml ; then
+	rm -f ckpt.cnt ckpt.go ckpt.btec
+	echo "failed: test checkpoint crash"
+	exit 1
+fi
+r=`cat ckpt.cnt`
+rm -f ckpt.cnt ckpt.go ckpt.btec
+if [ "$r" != "a" ] ; then
+	echo "failed: output of test checkpoint crash"
+	exit 1
+fi
+echo "ok test checkpoint crash"
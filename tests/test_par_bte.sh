@@ -0,0 +1,35 @@
+BTE_CMD=../src/bte
+
+echo "par two ok actions"
+if ! r=`$BTE_CMD test_par_two_ok_bt.xml 2>&1` ; then
+	echo "failed: par two ok"
+	exit 1
+fi
+m="Hi fast
+Hi slow"
+if [ "$r" != "$m" ]; then
+	echo "failed: output of par two ok"
+	exit 1
+fi
+echo "ok par two ok actions"
+
+echo "not par one fail one ok actions"
+if r=`$BTE_CMD test_par_one_fail_one_ok_bt.xml 2>&1`; then
+	echo "failed: not par one fail one ok actions"
+	exit 1
+fi
+echo "ok not par one fail one ok actions"
+
+echo "par threshold"
+if ! r=`$BTE_CMD test_par_threshold_bt.xml 2>&1` ; then
+	echo "failed: par threshold"
+	exit 1
+fi
+echo "ok par threshold"
+
+echo "not par bad threshold"
+if $BTE_CMD test_par_bad_threshold_bt.xml 2>/dev/null ; then
+	echo "failed: not par bad threshold"
+	exit 1
+fi
+echo "ok not par bad threshold"
@@ -0,0 +1,30 @@
+BTE_CMD=../src/bte
+
+echo "test pool"
+if ! r=`$BTE_CMD -j 4 test_par_two_ok_bt.xml test_seq_2l_ok_bt.xml \
+		test_one_ok_action_bt.xml test_seq_one_ok_bt.xml test_one_ok_action_bt.xml` ; then
+	echo "failed: test pool"
+	exit 1
+fi
+if [ `echo "$r" | grep -c "^Hi$"` -lt 2 ] ; then
+	echo "failed: output of test pool"
+	exit 1
+fi
+echo "ok test pool"
+
+echo "test pool one fail"
+$BTE_CMD -j 2 test_one_ok_action_bt.xml test_retry_fail_bt.xml \
+		test_seq_2l_ok_bt.xml > /dev/null
+if [ $? -ne 1 ] ; then
+	echo "failed: test pool one fail"
+	exit 1
+fi
+echo "ok test pool one fail"
+
+echo "test pool bad file"
+$BTE_CMD -j 0 test_one_ok_action_bt.xml test_bad_xml.xml > /dev/null 2>&1
+if [ $? -ne 3 ] ; then
+	echo "failed: test pool bad file"
+	exit 1
+fi
+echo "ok test pool bad file"
@@ -0,0 +1,53 @@
+BTE_CMD=../src/bte
+
+echo "test retry"
+rm -f retry.cnt retry.flag
+if ! r=`$BTE_CMD -S test_retry_bt.xml 2> retry.err` ; then
+	rm -f retry.cnt retry.flag retry.err
+	echo "failed: test retry"
+	exit 1
+fi
+# backoff is waited for on timer, tree is not ticked meanwhile
+ticks=`sed -n 's/.* ticks \([0-9]*\) .*/\1/p' retry.err`
+rm -f retry.cnt retry.flag retry.err
+if [ `echo "$r" | grep -c "^tick$"` -ne 3 ] || 
+		! echo "$r" | grep -q "^flaky 2$" || ! echo "$r" | grep -q "^flag$" || 
+		[ -z "$ticks" ] || [ "$ticks" -ge 100 ] ; then
+	echo "failed: output of test retry"
+	exit 1
+fi
+echo "ok test retry"
+
+echo "test retry fail"
+if $BTE_CMD -l retry.btel test_retry_fail_bt.xml > /dev/null ; then
+	rm -f retry.btel
+	echo "failed: test retry fail"
+	exit 1
+fi
+if ! r=`../src/bte-log retry.btel` || 
+		[ `echo "$r" | grep -c "run [12] ended failure, run again$"` -ne 2 ] || 
+		echo "$r" | grep -q "run 3 ended" ; then
+	rm -f retry.btel
+	echo "failed: output of test retry fail"
+	exit 1
+fi
+rm -f retry.btel
+echo "ok test retry fail"
+
+echo "test retry bad"
+if r=`$BTE_CMD test_retry_bad_bt.xml` ; then
+	echo "failed: test retry bad"
+	exit 1
+fi
+echo "ok test retry bad"
+
+echo "test retry binary"
+rm -f retry.cnt retry.flag
+if ! $BTE_CMD compile test_retry_bt.xml -o retry.bteb > /dev/null || 
+		! r=`$BTE_CMD retry.bteb` || ! echo "$r" | grep -q "^flaky 2$" ; then
+	rm -f retry.bteb retry.cnt retry.flag
+	echo "failed: test retry binary"
+	exit 1
+fi
+rm -f retry.bteb retry.cnt retry.flag
+echo "ok test retry binary"
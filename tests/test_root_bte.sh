@@ -27,3 +27,54 @@ if ! r=`$BTE_CMD test_one_ok_action_bt.xml 2>&1` ; then
 	exit 1
 fi
 
+echo "state dump"
+if ! $BTE_CMD -s state_out.xml test_one_ok_action_bt.xml > /dev/null ; then
+	rm -f state_out.xml
+	echo "failed: state dump"
+	exit 1
+fi
+if ! grep -q "<exec _state_=\"success\">echo Hi</exec>" state_out.xml ; then
+	rm -f state_out.xml
+	echo "failed: output of state dump"
+	exit 1
+fi
+rm -f state_out.xml
+echo "ok state dump"
+
+echo "trace dump"
+if ! $BTE_CMD -t trace_out.json test_one_ok_action_bt.xml > /dev/null ; then
+	rm -f trace_out.json
+	echo "failed: trace dump"
+	exit 1
+fi
+if ! grep -q "^{\"traceEvents\":\[" trace_out.json || 
+		! grep -q "{\"name\":\"w_0\",\"cat\":\"node\",.*\"ph\":\"X\"" trace_out.json || 
+		! grep -q "\"cat\":\"spawn\"" trace_out.json || 
+		! grep -q "\"rc\":\"success\",\"from\":\"\(running\|unknown\)\"" trace_out.json ; then
+	rm -f trace_out.json
+	echo "failed: output of trace dump"
+	exit 1
+fi
+rm -f trace_out.json
+echo "ok trace dump"
+
+echo "binary log"
+if ! $BTE_CMD -v -l log_out.btel test_one_ok_action_bt.xml > /dev/null ; then
+	rm -f log_out.btel
+	echo "failed: binary log"
+	exit 1
+fi
+if ! r=`../src/bte-log log_out.btel` ||
+		! echo "$r" | grep -q "node 1: spawned pid [0-9]* fd [0-9]*$" ||
+		! echo "$r" | grep -q "node 1: enter state unknown$" ||
+		! echo "$r" | grep -q "node 0: state success from \(running\|unknown\)$" ; then
+	rm -f log_out.btel
+	echo "failed: output of binary log"
+	exit 1
+fi
+rm -f log_out.btel
+if ../src/bte-log test_one_ok_action_bt.xml > /dev/null ; then
+	echo "failed: binary log of xml file"
+	exit 1
+fi
+echo "ok binary log"
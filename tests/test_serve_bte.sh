@@ -0,0 +1,81 @@
+BTE_CMD=../src/bte
+BTE_SOCK=${TMPDIR:-/tmp}/bte_test.$$.sock
+
+$BTE_CMD --serve $BTE_SOCK &
+BTE_PID=$!
+trap 'kill $BTE_PID 2>/dev/null' EXIT
+i=0
+while [ ! -S $BTE_SOCK ] && [ $i -lt 50 ]; do
+	sleep 0.1
+	i=$((i + 1))
+done
+
+echo "serve one ok action"
+if ! r=`$BTE_CMD --submit $BTE_SOCK test_one_ok_action_bt.xml 2>&1` ; then
+	echo "failed: serve one ok action"
+	exit 1
+fi
+m="Hi"
+if [ "$r" != "$m" ]; then
+	echo "failed: output of serve one ok action"
+	exit 1
+fi
+echo "ok serve one ok action"
+
+echo "not serve one fail action"
+if r=`$BTE_CMD --submit $BTE_SOCK test_one_fail_action_bt.xml 2>&1` ; then
+	echo "failed: not serve one fail action"
+	exit 1
+fi
+echo "ok not serve one fail action"
+
+echo "serve inline xml"
+if ! r=`$BTE_CMD --submit $BTE_SOCK - < test_two_ok_action_bt.xml 2>&1` ; then
+	echo "failed: serve inline xml"
+	exit 1
+fi
+m="Hi
+Hi 1"
+if [ "$r" != "$m" ]; then
+	echo "failed: output of serve inline xml"
+	exit 1
+fi
+echo "ok serve inline xml"
+
+echo "serve concurrent trees"
+$BTE_CMD --submit $BTE_SOCK test_par_two_ok_bt.xml > /dev/null 2>&1 &
+p1=$!
+if ! r=`$BTE_CMD --submit $BTE_SOCK test_stream_settle_bt.xml 2>&1` ; then
+	echo "failed: serve concurrent trees"
+	exit 1
+fi
+if ! wait $p1 ; then
+	echo "failed: serve concurrent trees"
+	exit 1
+fi
+echo "ok serve concurrent trees"
+
+echo "serve next to stalled client"
+# client output is not read, so client stops reading its socket
+$BTE_CMD --submit $BTE_SOCK test_serve_big_bt.xml 2>/dev/null | sleep 5 &
+sleep 1
+if ! r=`timeout 3 $BTE_CMD --submit $BTE_SOCK test_one_ok_action_bt.xml 2>&1` || 
+		[ "$r" != "Hi" ] ; then
+	echo "failed: serve next to stalled client"
+	exit 1
+fi
+echo "ok serve next to stalled client"
+
+echo "serve next to stream ignoring hangup"
+# closed stream process keeps running, serve must not wait for it
+$BTE_CMD --submit $BTE_SOCK test_stream_close_hup_bt.xml > hup.out 2>&1 &
+p1=$!
+sleep 1.3
+if ! r=`timeout 2 $BTE_CMD --submit $BTE_SOCK test_one_ok_action_bt.xml 2>&1` || 
+		[ "$r" != "Hi" ] || ! wait $p1 || [ "`cat hup.out`" != "done" ] ; then
+	rm -f hup.out
+	echo "failed: serve next to stream ignoring hangup"
+	exit 1
+fi
+rm -f hup.out
+echo "ok serve next to stream ignoring hangup"
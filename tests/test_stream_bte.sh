@@ -30,3 +30,63 @@ if ! r=`$BTE_CMD test_stream_write_shell_bt.xml` ; then
 	exit 1
 fi
 echo "ok test stream expect command"
+
+echo "test stream write escape"
+if ! r=`$BTE_CMD test_stream_write_escape_bt.xml` ; then
+	echo "failed: test stream write escape"
+	exit 1
+fi
+echo "ok test stream write escape"
+
+echo "test stream settle"
+if ! r=`$BTE_CMD test_stream_settle_bt.xml` ; then
+	echo "failed: test stream settle"
+	exit 1
+fi
+echo "ok test stream settle"
+
+echo "test stream bad settle"
+if r=`$BTE_CMD test_stream_settle_bad_bt.xml 2>&1` ; then
+	echo "failed: test stream bad settle"
+	exit 1
+fi
+echo "ok test stream bad settle"
+
+echo "test stream expect glob"
+if ! r=`$BTE_CMD test_stream_expect_glob_bt.xml` ; then
+	echo "failed: test stream expect glob"
+	exit 1
+fi
+echo "ok test stream expect glob"
+
+echo "test stream expect dropped anchor"
+if ! r=`$BTE_CMD test_stream_expect_dropped_bt.xml` ; then
+	echo "failed: test stream expect dropped anchor"
+	exit 1
+fi
+if [ "$r" != "not anchored" ] ; then
+	echo "failed: output of test stream expect dropped anchor"
+	exit 1
+fi
+echo "ok test stream expect dropped anchor"
+
+echo "test stream reopen"
+if ! r=`$BTE_CMD test_stream_reopen_bt.xml` ; then
+	echo "failed: test stream reopen"
+	exit 1
+fi
+echo "ok test stream reopen"
+
+echo "test stream expect eof"
+if r=`$BTE_CMD test_stream_expect_eof_bt.xml` ; then
+	echo "failed: test stream expect eof"
+	exit 1
+fi
+echo "ok test stream expect eof"
+
+echo "test stream bad expect"
+if r=`$BTE_CMD test_stream_expect_bad_bt.xml 2>&1` ; then
+	echo "failed: test stream bad expect"
+	exit 1
+fi
+echo "ok test stream bad expect"
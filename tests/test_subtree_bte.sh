@@ -0,0 +1,63 @@
+BTE_CMD=../src/bte
+
+echo "test subtree"
+if ! r=`$BTE_CMD test_subtree_bt.xml` ; then
+	echo "failed: test subtree"
+	exit 1
+fi
+if [ "$r" != "done" ] ; then
+	echo "failed: output of test subtree"
+	exit 1
+fi
+echo "ok test subtree"
+
+echo "test subtree parallel params"
+if ! r=`$BTE_CMD test_subtree_parallel_bt.xml` ; then
+	echo "failed: test subtree parallel params"
+	exit 1
+fi
+if [ "$r" != "bye failed
+done" ] ; then
+	echo "failed: output of test subtree parallel params"
+	exit 1
+fi
+echo "ok test subtree parallel params"
+
+echo "test subtree param fail"
+if r=`$BTE_CMD test_subtree_param_fail_bt.xml` ; then
+	echo "failed: test subtree param fail"
+	exit 1
+fi
+echo "ok test subtree param fail"
+
+echo "test subtree loop"
+if r=`$BTE_CMD test_subtree_loop_bt.xml 2>&1` ; then
+	echo "failed: test subtree loop"
+	exit 1
+fi
+echo "ok test subtree loop"
+
+echo "test subtree state dump"
+if ! $BTE_CMD -s subtree_state.xml test_subtree_bt.xml > /dev/null ; then
+	rm -f subtree_state.xml
+	echo "failed: test subtree state dump"
+	exit 1
+fi
+if ! grep -q "<subtree id=\"second_echo\" ref=\"[^\"]*\" _state_=\"success\"/>" subtree_state.xml || 
+		! grep -q "<exec _state_=\"success\">echo done</exec>" subtree_state.xml ; then
+	rm -f subtree_state.xml
+	echo "failed: output of test subtree state dump"
+	exit 1
+fi
+rm -f subtree_state.xml
+echo "ok test subtree state dump"
+
+echo "test subtree binary"
+if ! $BTE_CMD compile test_subtree_bt.xml -o subtree.bteb > /dev/null || 
+		! r=`$BTE_CMD subtree.bteb` || [ "$r" != "done" ] ; then
+	rm -f subtree.bteb
+	echo "failed: test subtree binary"
+	exit 1
+fi
+rm -f subtree.bteb
+echo "ok test subtree binary"
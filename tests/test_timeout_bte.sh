@@ -0,0 +1,53 @@
+BTE_CMD=../src/bte
+
+echo "test timeout decorator"
+start=`date +%s`
+if ! r=`$BTE_CMD test_timeout_decorator_bt.xml` ; then
+	echo "failed: test timeout decorator"
+	exit 1
+fi
+if ! echo "$r" | grep -q "^fallback" || [ $((`date +%s` - start)) -ge 4 ] ; then
+	echo "failed: output of test timeout decorator"
+	exit 1
+fi
+echo "ok test timeout decorator"
+
+echo "test timeout expect"
+start=`date +%s`
+if r=`$BTE_CMD test_timeout_expect_bt.xml` ; then
+	echo "failed: test timeout expect"
+	exit 1
+fi
+if [ $((`date +%s` - start)) -ge 4 ] ; then
+	echo "failed: time of test timeout expect"
+	exit 1
+fi
+echo "ok test timeout expect"
+
+echo "test timeout ok"
+if ! r=`$BTE_CMD test_timeout_ok_bt.xml` ; then
+	echo "failed: test timeout ok"
+	exit 1
+fi
+if ! echo "$r" | grep -q "^in time" ; then
+	echo "failed: output of test timeout ok"
+	exit 1
+fi
+echo "ok test timeout ok"
+
+echo "test timeout bad"
+if r=`$BTE_CMD test_timeout_bad_bt.xml` ; then
+	echo "failed: test timeout bad"
+	exit 1
+fi
+echo "ok test timeout bad"
+
+echo "test timeout binary"
+if ! $BTE_CMD compile test_timeout_decorator_bt.xml -o timeout.bteb > /dev/null || 
+		! r=`$BTE_CMD timeout.bteb` || ! echo "$r" | grep -q "^fallback" ; then
+	rm -f timeout.bteb
+	echo "failed: test timeout binary"
+	exit 1
+fi
+rm -f timeout.bteb
+echo "ok test timeout binary"
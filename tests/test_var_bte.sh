@@ -0,0 +1,37 @@
+BTE_CMD=../src/bte
+
+echo "test var capture"
+if ! r=`$BTE_CMD test_var_capture_bt.xml` ; then
+	echo "failed: test var capture"
+	exit 1
+fi
+# captured exec output is not printed
+if echo "$r" | grep -q "^w0rld" ; then
+	echo "failed: output of test var capture"
+	exit 1
+fi
+echo "ok test var capture"
+
+echo "test var match fail"
+if r=`$BTE_CMD test_var_match_fail_bt.xml` ; then
+	echo "failed: test var match fail"
+	exit 1
+fi
+echo "ok test var match fail"
+
+echo "test var unset"
+if r=`$BTE_CMD test_var_unset_bt.xml` ; then
+	echo "failed: test var unset"
+	exit 1
+fi
+echo "ok test var unset"
+
+echo "test var binary"
+if ! $BTE_CMD compile test_var_capture_bt.xml -o var_capture.bteb > /dev/null || 
+		! r=`$BTE_CMD var_capture.bteb` ; then
+	rm -f var_capture.bteb
+	echo "failed: test var binary"
+	exit 1
+fi
+rm -f var_capture.bteb
+echo "ok test var binary"